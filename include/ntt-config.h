@@ -0,0 +1,508 @@
+/* ntt-config.h - (generated by ./configure). Please rerun ./configure, and do NOT modify this file!
+*
+* Configure Script Ran:
+* $ ./configure
+*
+* Vars:
+* CC            = cc
+* CFLAGS        = -Ofast -fopenmp -std=c99
+* LDFLAGS       = 
+* PREFIX        = /usr/local
+* DESTDIR       = 
+* PWD           = /root/repo
+* V             = [0, 0, 1]
+* BUILD_TYPE    = release
+* MODULES       = []
+* NTT_PRIMES    = 998244353,469762049,167772161
+*
+*
+* Misc.:
+* sys.platform  = linux
+*
+*/
+
+#pragma once
+#ifndef NTT_CONFIG_H__
+#define NTT_CONFIG_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* VERSION */
+
+#define NTT_VERSION_MAJOR 0
+#define NTT_VERSION_MINOR 0
+#define NTT_VERSION_PATCH 1
+
+#define NTT_BUILD_STR "release"
+#define NTT_BUILD_RELEASE
+
+
+/* platform info */
+
+#define NTT_PLATFORM_NAME "linux"
+
+#define NTT_API_EXPORT 
+#define NTT_API_IMPORT 
+
+#ifdef NTT_BUILD
+#define NTT_API NTT_API_EXPORT
+#else
+#define NTT_API NTT_API_IMPORT
+#endif
+
+#define NTT_PREFIX "/usr/local"
+
+
+/* fixed primes */
+
+// the primes that have specialized kernels (from './configure --ntt-primes'), as an
+//   X-macro of X(index, p, primitive root)
+#define NTT_FIXED_PRIMES(X) X(0, 998244353ULL, 3ULL) X(1, 469762049ULL, 3ULL) X(2, 167772161ULL, 3ULL)
+
+
+/* table of NTT primes */
+
+// the largest few primes p = 1 (mod 2^k) below 2^30, 2^31, 2^32, 2^50, 2^62, 2^63, for
+//   each k <= 40, sorted from largest to smallest, as an X-macro of X(p, primitive root)
+//   (see 'ntt_prime_lookup')
+#define NTT_PRIME_TABLE(X) \
+    X(9223372036854775783ULL, 3ULL) \
+    X(9223372036854775643ULL, 2ULL) \
+    X(9223372036854775549ULL, 2ULL) \
+    X(9223372036854775507ULL, 3ULL) \
+    X(9223372036854775433ULL, 3ULL) \
+    X(9223372036854775421ULL, 2ULL) \
+    X(9223372036854775417ULL, 10ULL) \
+    X(9223372036854775337ULL, 3ULL) \
+    X(9223372036854775097ULL, 3ULL) \
+    X(9223372036854775073ULL, 5ULL) \
+    X(9223372036854775057ULL, 5ULL) \
+    X(9223372036854774257ULL, 3ULL) \
+    X(9223372036854773953ULL, 31ULL) \
+    X(9223372036854772961ULL, 3ULL) \
+    X(9223372036854772801ULL, 17ULL) \
+    X(9223372036854772289ULL, 3ULL) \
+    X(9223372036854771841ULL, 14ULL) \
+    X(9223372036854771457ULL, 10ULL) \
+    X(9223372036854769921ULL, 22ULL) \
+    X(9223372036854764417ULL, 3ULL) \
+    X(9223372036854759169ULL, 37ULL) \
+    X(9223372036854758401ULL, 7ULL) \
+    X(9223372036854747649ULL, 13ULL) \
+    X(9223372036854739969ULL, 11ULL) \
+    X(9223372036854739457ULL, 3ULL) \
+    X(9223372036854675457ULL, 5ULL) \
+    X(9223372036854618113ULL, 3ULL) \
+    X(9223372036854577153ULL, 5ULL) \
+    X(9223372036854556673ULL, 3ULL) \
+    X(9223372036854497281ULL, 13ULL) \
+    X(9223372036854460417ULL, 5ULL) \
+    X(9223372036854374401ULL, 11ULL) \
+    X(9223372036854325249ULL, 23ULL) \
+    X(9223372036854095873ULL, 3ULL) \
+    X(9223372036854005761ULL, 7ULL) \
+    X(9223372036853874689ULL, 3ULL) \
+    X(9223372036853710849ULL, 31ULL) \
+    X(9223372036853661697ULL, 5ULL) \
+    X(9223372036853235713ULL, 3ULL) \
+    X(9223372036852744193ULL, 3ULL) \
+    X(9223372036852482049ULL, 11ULL) \
+    X(9223372036849729537ULL, 5ULL) \
+    X(9223372036844421121ULL, 11ULL) \
+    X(9223372036836950017ULL, 10ULL) \
+    X(9223372036835770369ULL, 11ULL) \
+    X(9223372036833673217ULL, 3ULL) \
+    X(9223372036829347841ULL, 3ULL) \
+    X(9223372036824629249ULL, 3ULL) \
+    X(9223372036818075649ULL, 11ULL) \
+    X(9223372036803919873ULL, 5ULL) \
+    X(9223372036797104129ULL, 3ULL) \
+    X(9223372036752015361ULL, 11ULL) \
+    X(9223372036743626753ULL, 3ULL) \
+    X(9223372036737335297ULL, 3ULL) \
+    X(9223372036726849537ULL, 10ULL) \
+    X(9223372036636672001ULL, 6ULL) \
+    X(9223372036343070721ULL, 17ULL) \
+    X(9223372036229824513ULL, 7ULL) \
+    X(9223372036166909953ULL, 5ULL) \
+    X(9223372036083023873ULL, 3ULL) \
+    X(9223372036015915009ULL, 13ULL) \
+    X(9223372035915251713ULL, 10ULL) \
+    X(9223372035479044097ULL, 3ULL) \
+    X(9223372034505965569ULL, 11ULL) \
+    X(9223372034170421249ULL, 3ULL) \
+    X(9223372032291373057ULL, 5ULL) \
+    X(9223372030680760321ULL, 7ULL) \
+    X(9223372020211777537ULL, 5ULL) \
+    X(9223372006790004737ULL, 3ULL) \
+    X(9223371984241426433ULL, 3ULL) \
+    X(9223371941291753473ULL, 10ULL) \
+    X(9223371938070528001ULL, 19ULL) \
+    X(9223371877940985857ULL, 5ULL) \
+    X(9223371841433763841ULL, 19ULL) \
+    X(9223371564408373249ULL, 13ULL) \
+    X(9223371280940531713ULL, 5ULL) \
+    X(9223371229400924161ULL, 7ULL) \
+    X(9223371049012297729ULL, 7ULL) \
+    X(9223370714004848641ULL, 13ULL) \
+    X(9223370507846418433ULL, 5ULL) \
+    X(9223370353227595777ULL, 5ULL) \
+    X(9223369906550996993ULL, 5ULL) \
+    X(9223369837831520257ULL, 7ULL) \
+    X(9223369288075706369ULL, 3ULL) \
+    X(9223365302346055681ULL, 11ULL) \
+    X(9223363103322800129ULL, 3ULL) \
+    X(9223362416128032769ULL, 17ULL) \
+    X(9223355819058266113ULL, 5ULL) \
+    X(9223353345157103617ULL, 5ULL) \
+    X(9223352795401289729ULL, 3ULL) \
+    X(9223346748087336961ULL, 7ULL) \
+    X(9223344549064081409ULL, 3ULL) \
+    X(4611686018427387847ULL, 6ULL) \
+    X(4611686018427387817ULL, 5ULL) \
+    X(4611686018427387787ULL, 2ULL) \
+    X(4611686018427387761ULL, 3ULL) \
+    X(4611686018427387737ULL, 3ULL) \
+    X(4611686018427387733ULL, 2ULL) \
+    X(4611686018427387617ULL, 3ULL) \
+    X(4611686018427387409ULL, 7ULL) \
+    X(4611686018427387329ULL, 3ULL) \
+    X(4611686018427387073ULL, 5ULL) \
+    X(4611686018427386081ULL, 3ULL) \
+    X(4611686018427385537ULL, 5ULL) \
+    X(4611686018427384641ULL, 6ULL) \
+    X(4611686018427382913ULL, 3ULL) \
+    X(4611686018427379201ULL, 19ULL) \
+    X(4611686018427378049ULL, 7ULL) \
+    X(4611686018427375361ULL, 7ULL) \
+    X(4611686018427373313ULL, 3ULL) \
+    X(4611686018427372289ULL, 7ULL) \
+    X(4611686018427366401ULL, 6ULL) \
+    X(4611686018427365377ULL, 7ULL) \
+    X(4611686018427361793ULL, 3ULL) \
+    X(4611686018427322369ULL, 7ULL) \
+    X(4611686018427289601ULL, 3ULL) \
+    X(4611686018427277313ULL, 3ULL) \
+    X(4611686018427228161ULL, 13ULL) \
+    X(4611686018427215873ULL, 3ULL) \
+    X(4611686018427199489ULL, 13ULL) \
+    X(4611686018426454017ULL, 3ULL) \
+    X(4611686018426257409ULL, 3ULL) \
+    X(4611686018425815041ULL, 3ULL) \
+    X(4611686018424733697ULL, 3ULL) \
+    X(4611686018423390209ULL, 11ULL) \
+    X(4611686018423062529ULL, 3ULL) \
+    X(4611686018422669313ULL, 3ULL) \
+    X(4611686018416115713ULL, 10ULL) \
+    X(4611686018406940673ULL, 3ULL) \
+    X(4611686018405367809ULL, 3ULL) \
+    X(4611686018326724609ULL, 3ULL) \
+    X(4611686018325676033ULL, 5ULL) \
+    X(4611686018309947393ULL, 5ULL) \
+    X(4611686018282684417ULL, 3ULL) \
+    X(4611686018257518593ULL, 3ULL) \
+    X(4611686018171535361ULL, 17ULL) \
+    X(4611686018058289153ULL, 5ULL) \
+    X(4611686017974403073ULL, 3ULL) \
+    X(4611686017554972673ULL, 5ULL) \
+    X(4611686016649003009ULL, 17ULL) \
+    X(4611686015004835841ULL, 3ULL) \
+    X(4611686009971671041ULL, 6ULL) \
+    X(4611686007555751937ULL, 3ULL) \
+    X(4611686004066091009ULL, 13ULL) \
+    X(4611686003260784641ULL, 11ULL) \
+    X(4611685989973229569ULL, 7ULL) \
+    X(4611685984336084993ULL, 15ULL) \
+    X(4611685982725472257ULL, 5ULL) \
+    X(4611685981383294977ULL, 3ULL) \
+    X(4611685944339202049ULL, 3ULL) \
+    X(4611685942728589313ULL, 3ULL) \
+    X(4611685941117976577ULL, 3ULL) \
+    X(4611685917495656449ULL, 11ULL) \
+    X(4611685860587339777ULL, 3ULL) \
+    X(4611685692009873409ULL, 19ULL) \
+    X(4611685672682520577ULL, 5ULL) \
+    X(4611685606110527489ULL, 3ULL) \
+    X(4611685318347718657ULL, 5ULL) \
+    X(4611685219563470849ULL, 3ULL) \
+    X(4611685125074190337ULL, 5ULL) \
+    X(4611685090714451969ULL, 3ULL) \
+    X(4611685021994975233ULL, 5ULL) \
+    X(4611682857331458049ULL, 13ULL) \
+    X(4611679627516051457ULL, 3ULL) \
+    X(4611678734162853889ULL, 11ULL) \
+    X(4611672549409947649ULL, 14ULL) \
+    X(4611660454782042113ULL, 3ULL) \
+    X(4611656056735531009ULL, 11ULL) \
+    X(4611652208444833793ULL, 3ULL) \
+    X(4611627194555301889ULL, 7ULL) \
+    X(4611624995532046337ULL, 3ULL) \
+    X(4611615649683210241ULL, 11ULL) \
+    X(4611613450659954689ULL, 3ULL) \
+    X(4611549678985543681ULL, 19ULL) \
+    X(4611546380450660353ULL, 5ULL) \
+    X(1125899906842597ULL, 6ULL) \
+    X(1125899906842589ULL, 2ULL) \
+    X(1125899906842573ULL, 2ULL) \
+    X(1125899906842553ULL, 3ULL) \
+    X(1125899906842273ULL, 5ULL) \
+    X(1125899906842201ULL, 22ULL) \
+    X(1125899906842177ULL, 5ULL) \
+    X(1125899906842033ULL, 5ULL) \
+    X(1125899906841713ULL, 3ULL) \
+    X(1125899906841377ULL, 3ULL) \
+    X(1125899906840897ULL, 3ULL) \
+    X(1125899906840833ULL, 5ULL) \
+    X(1125899906839937ULL, 3ULL) \
+    X(1125899906837633ULL, 3ULL) \
+    X(1125899906826241ULL, 22ULL) \
+    X(1125899906824961ULL, 3ULL) \
+    X(1125899906822657ULL, 3ULL) \
+    X(1125899906820097ULL, 7ULL) \
+    X(1125899906802689ULL, 3ULL) \
+    X(1125899906774017ULL, 5ULL) \
+    X(1125899906738177ULL, 3ULL) \
+    X(1125899906732033ULL, 3ULL) \
+    X(1125899906629633ULL, 10ULL) \
+    X(1125899906437121ULL, 6ULL) \
+    X(1125899906424833ULL, 5ULL) \
+    X(1125899906260993ULL, 5ULL) \
+    X(1125899905744897ULL, 7ULL) \
+    X(1125899905351681ULL, 13ULL) \
+    X(1125899904679937ULL, 3ULL) \
+    X(1125899903991809ULL, 3ULL) \
+    X(1125899903827969ULL, 11ULL) \
+    X(1125899903795201ULL, 3ULL) \
+    X(1125899903500289ULL, 3ULL) \
+    X(1125899903107073ULL, 3ULL) \
+    X(1125899902124033ULL, 3ULL) \
+    X(1125899887312897ULL, 13ULL) \
+    X(1125899886395393ULL, 3ULL) \
+    X(1125899884036097ULL, 3ULL) \
+    X(1125899882987521ULL, 35ULL) \
+    X(1125899865948161ULL, 3ULL) \
+    X(1125899861753857ULL, 5ULL) \
+    X(1125899846025217ULL, 5ULL) \
+    X(1125899834490881ULL, 3ULL) \
+    X(1125899831345153ULL, 3ULL) \
+    X(1125899818762241ULL, 3ULL) \
+    X(1125899799887873ULL, 3ULL) \
+    X(1125899726487553ULL, 5ULL) \
+    X(1125899692933121ULL, 3ULL) \
+    X(1125899630018561ULL, 7ULL) \
+    X(1125899479023617ULL, 5ULL) \
+    X(1125899462246401ULL, 7ULL) \
+    X(1125899437080577ULL, 5ULL) \
+    X(1125899302862849ULL, 3ULL) \
+    X(1125899286085633ULL, 5ULL) \
+    X(1125899185422337ULL, 5ULL) \
+    X(1125898195566593ULL, 3ULL) \
+    X(1125897625141249ULL, 29ULL) \
+    X(1125896819834881ULL, 14ULL) \
+    X(1125892793303041ULL, 17ULL) \
+    X(1125883934932993ULL, 5ULL) \
+    X(1125872257990657ULL, 5ULL) \
+    X(1125871452684289ULL, 7ULL) \
+    X(1125860446830593ULL, 3ULL) \
+    X(1125845146009601ULL, 3ULL) \
+    X(1125844072267777ULL, 5ULL) \
+    X(1125840314171393ULL, 3ULL) \
+    X(1125825818656769ULL, 3ULL) \
+    X(1125818302464001ULL, 7ULL) \
+    X(1125816154980353ULL, 3ULL) \
+    X(1125809712529409ULL, 3ULL) \
+    X(1125629323902977ULL, 3ULL) \
+    X(1125625028935681ULL, 11ULL) \
+    X(1125487589982209ULL, 3ULL) \
+    X(1125281431552001ULL, 3ULL) \
+    X(1125178352336897ULL, 3ULL) \
+    X(1124044480970753ULL, 3ULL) \
+    X(1123426005680129ULL, 3ULL) \
+    X(1121914177191937ULL, 5ULL) \
+    X(1114355034750977ULL, 3ULL) \
+    X(1108307720798209ULL, 11ULL) \
+    X(1096762848706561ULL, 61ULL) \
+    X(1086317488242689ULL, 3ULL) \
+    X(1072023837081601ULL, 11ULL) \
+    X(1025844348715009ULL, 13ULL) \
+    X(4294967291ULL, 2ULL) \
+    X(4294967279ULL, 7ULL) \
+    X(4294967231ULL, 7ULL) \
+    X(4294967197ULL, 6ULL) \
+    X(4294967189ULL, 2ULL) \
+    X(4294967161ULL, 58ULL) \
+    X(4294967029ULL, 6ULL) \
+    X(4294966769ULL, 3ULL) \
+    X(4294966657ULL, 5ULL) \
+    X(4294966553ULL, 3ULL) \
+    X(4294966337ULL, 3ULL) \
+    X(4294966177ULL, 5ULL) \
+    X(4294965793ULL, 5ULL) \
+    X(4294965313ULL, 5ULL) \
+    X(4294964929ULL, 11ULL) \
+    X(4294962817ULL, 5ULL) \
+    X(4294962689ULL, 3ULL) \
+    X(4294961921ULL, 3ULL) \
+    X(4294957057ULL, 10ULL) \
+    X(4294955009ULL, 3ULL) \
+    X(4294953473ULL, 3ULL) \
+    X(4294935553ULL, 7ULL) \
+    X(4294929409ULL, 17ULL) \
+    X(4294924289ULL, 3ULL) \
+    X(4294914049ULL, 7ULL) \
+    X(4294828033ULL, 10ULL) \
+    X(4294807553ULL, 3ULL) \
+    X(4294729729ULL, 21ULL) \
+    X(4294483969ULL, 14ULL) \
+    X(4294475777ULL, 5ULL) \
+    X(4293918721ULL, 19ULL) \
+    X(4293836801ULL, 6ULL) \
+    X(4293230593ULL, 13ULL) \
+    X(4292804609ULL, 3ULL) \
+    X(4292149249ULL, 14ULL) \
+    X(4292018177ULL, 5ULL) \
+    X(4291952641ULL, 17ULL) \
+    X(4289462273ULL, 3ULL) \
+    X(4288806913ULL, 5ULL) \
+    X(4286054401ULL, 11ULL) \
+    X(4280025089ULL, 3ULL) \
+    X(4276092929ULL, 3ULL) \
+    X(4271374337ULL, 3ULL) \
+    X(4260364289ULL, 3ULL) \
+    X(4253024257ULL, 5ULL) \
+    X(4221566977ULL, 5ULL) \
+    X(4213178369ULL, 3ULL) \
+    X(4194304001ULL, 3ULL) \
+    X(4106223617ULL, 3ULL) \
+    X(4076863489ULL, 7ULL) \
+    X(3942645761ULL, 3ULL) \
+    X(3892314113ULL, 3ULL) \
+    X(3489660929ULL, 3ULL) \
+    X(3221225473ULL, 5ULL) \
+    X(2885681153ULL, 3ULL) \
+    X(2281701377ULL, 3ULL) \
+    X(2147483647ULL, 7ULL) \
+    X(2147483629ULL, 2ULL) \
+    X(2147483587ULL, 2ULL) \
+    X(2147483579ULL, 2ULL) \
+    X(2147483549ULL, 3ULL) \
+    X(2147483497ULL, 5ULL) \
+    X(2147483489ULL, 3ULL) \
+    X(2147483353ULL, 5ULL) \
+    X(2147483249ULL, 3ULL) \
+    X(2147483137ULL, 10ULL) \
+    X(2147482817ULL, 3ULL) \
+    X(2147482273ULL, 5ULL) \
+    X(2147481793ULL, 5ULL) \
+    X(2147480897ULL, 3ULL) \
+    X(2147479937ULL, 3ULL) \
+    X(2147479681ULL, 22ULL) \
+    X(2147478017ULL, 3ULL) \
+    X(2147477249ULL, 3ULL) \
+    X(2147475713ULL, 3ULL) \
+    X(2147473921ULL, 11ULL) \
+    X(2147473409ULL, 3ULL) \
+    X(2147415041ULL, 3ULL) \
+    X(2147396609ULL, 3ULL) \
+    X(2147389441ULL, 11ULL) \
+    X(2147387393ULL, 5ULL) \
+    X(2147377153ULL, 5ULL) \
+    X(2147352577ULL, 5ULL) \
+    X(2147295233ULL, 3ULL) \
+    X(2147205121ULL, 7ULL) \
+    X(2147074049ULL, 11ULL) \
+    X(2146959361ULL, 19ULL) \
+    X(2146336769ULL, 3ULL) \
+    X(2146041857ULL, 3ULL) \
+    X(2145976321ULL, 7ULL) \
+    X(2144468993ULL, 3ULL) \
+    X(2142502913ULL, 3ULL) \
+    X(2135162881ULL, 7ULL) \
+    X(2134638593ULL, 3ULL) \
+    X(2132279297ULL, 5ULL) \
+    X(2130706433ULL, 3ULL) \
+    X(2121793537ULL, 5ULL) \
+    X(2114977793ULL, 3ULL) \
+    X(2113929217ULL, 5ULL) \
+    X(2099249153ULL, 3ULL) \
+    X(2095054849ULL, 11ULL) \
+    X(2088763393ULL, 5ULL) \
+    X(2025848833ULL, 10ULL) \
+    X(2013265921ULL, 31ULL) \
+    X(1811939329ULL, 13ULL) \
+    X(1711276033ULL, 29ULL) \
+    X(1073741789ULL, 2ULL) \
+    X(1073741783ULL, 5ULL) \
+    X(1073741741ULL, 2ULL) \
+    X(1073741723ULL, 2ULL) \
+    X(1073741717ULL, 2ULL) \
+    X(1073741689ULL, 13ULL) \
+    X(1073741561ULL, 3ULL) \
+    X(1073741441ULL, 3ULL) \
+    X(1073741329ULL, 7ULL) \
+    X(1073740609ULL, 13ULL) \
+    X(1073740529ULL, 15ULL) \
+    X(1073739937ULL, 10ULL) \
+    X(1073739649ULL, 13ULL) \
+    X(1073738753ULL, 3ULL) \
+    X(1073736449ULL, 3ULL) \
+    X(1073734913ULL, 3ULL) \
+    X(1073732609ULL, 3ULL) \
+    X(1073731073ULL, 3ULL) \
+    X(1073726977ULL, 5ULL) \
+    X(1073707009ULL, 23ULL) \
+    X(1073698817ULL, 3ULL) \
+    X(1073692673ULL, 3ULL) \
+    X(1073682433ULL, 5ULL) \
+    X(1073668097ULL, 3ULL) \
+    X(1073655809ULL, 3ULL) \
+    X(1073651713ULL, 10ULL) \
+    X(1073643521ULL, 6ULL) \
+    X(1073479681ULL, 11ULL) \
+    X(1073430529ULL, 7ULL) \
+    X(1073184769ULL, 11ULL) \
+    X(1073053697ULL, 5ULL) \
+    X(1072496641ULL, 11ULL) \
+    X(1071513601ULL, 23ULL) \
+    X(1070727169ULL, 11ULL) \
+    X(1068236801ULL, 3ULL) \
+    X(1062469633ULL, 5ULL) \
+    X(1056440321ULL, 3ULL) \
+    X(1053818881ULL, 7ULL) \
+    X(1051721729ULL, 6ULL) \
+    X(1049100289ULL, 7ULL) \
+    X(1045430273ULL, 3ULL) \
+    X(1012924417ULL, 5ULL) \
+    X(1004535809ULL, 3ULL) \
+    X(998244353ULL, 3ULL) \
+    X(985661441ULL, 3ULL) \
+    X(943718401ULL, 7ULL) \
+    X(935329793ULL, 3ULL) \
+    X(897581057ULL, 3ULL) \
+    X(880803841ULL, 26ULL) \
+    X(754974721ULL, 11ULL) \
+    X(469762049ULL, 3ULL) \
+    X(167772161ULL, 3ULL) \
+
+
+/* misc. defines */
+
+#define NTT__LINUX
+#define NTT_SHARED_END "so"
+#define NTT_STATIC_END "a"
+
+
+/* warnings */
+
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NTT_CONFIG_H__ */
+
@@ -28,6 +28,42 @@
 /* NTT types */
 
 
+// ntt_isa_t - instruction set extensions that the butterfly kernels are specialized for
+// NOTE: these are ordered, so that each one implies the ones before it
+typedef enum {
+
+    // portable C code
+    NTT_ISA_SCALAR = 0,
+
+    // 4 coefficients per instruction
+    NTT_ISA_AVX2,
+
+    // 8 coefficients per instruction
+    NTT_ISA_AVX512,
+
+    // 8 coefficients per instruction, with 52 bit multiplies (allowing larger 'p')
+    NTT_ISA_AVX512IFMA,
+
+} ntt_isa_t;
+
+// ntt_hugepages_t - how the large (at least 2MB) tables and buffers of the plans and
+//   multipliers are allocated (see 'ntt_set_hugepages')
+typedef enum {
+
+    // just from the heap (but still 64 byte aligned)
+    NTT_HUGEPAGES_OFF = 0,
+
+    // 'mmap' with MADV_HUGEPAGE, so that they get transparent huge pages if the kernel allows
+    //   it (the default)
+    NTT_HUGEPAGES_MADVISE,
+
+    // 'mmap' with MAP_HUGETLB, from the reserved huge pages (see 'vm.nr_hugepages'), which
+    //   falls back to NTT_HUGEPAGES_MADVISE if there aren't enough
+    NTT_HUGEPAGES_HUGETLB,
+
+} ntt_hugepages_t;
+
+
 // ntt_plan_gemm_t - plan for GEMM (Matrix-Multiplication) based NTT
 typedef struct {
 
@@ -49,17 +85,23 @@ typedef struct {
     // (size NxN)
     int64_t* mINTT;
 
+    // the (64 byte aligned) arena that all the matrices are allocated from
+    void* mem;
 
 } ntt_plan_gemm_t;
 
 // generate the empty GEMM-based plan
-#define NTT_PLAN_GEMM_EMPTY ((ntt_plan_gemm_t){ .N = 0, .p = 0, .mNTT = NULL, .mINTT = NULL })
+#define NTT_PLAN_GEMM_EMPTY ((ntt_plan_gemm_t){ .N = 0, .p = 0, .mNTT = NULL, .mINTT = NULL, .mem = NULL })
 
 // Initialize a GEMM-based plan, with 'N' points, mod 'p'
-// NOTE: p = Nk + 1, or, if p==0, then 'p' will be calculated as the smallest
-//   prime of the form (Nk+1)
+// NOTE: p = Nk + 1, or, if p==0, then 'p' will be the largest prime of the form (Nk+1)
+//   below 2^30 from the built-in table (see 'ntt_prime_lookup'), or if there's none, the
+//   smallest one
 void ntt_plan_gemm_init(ntt_plan_gemm_t* plan, int64_t N, int64_t p);
 
+// Free the plan's matrices, leaving it empty (so it can be initialized again)
+void ntt_plan_gemm_free(ntt_plan_gemm_t* plan);
+
 // Do forward NTT:
 // out = NTT(inp)
 void ntt_plan_gemm_NTT(ntt_plan_gemm_t* plan, int64_t* inp, int64_t* out);
@@ -69,6 +111,49 @@ void ntt_plan_gemm_NTT(ntt_plan_gemm_t* plan, int64_t* inp, int64_t* out);
 void ntt_plan_gemm_INTT(ntt_plan_gemm_t* plan, int64_t* inp, int64_t* out);
 
 
+// ntt_plan_gemm32_t - plan for GEMM based NTT with 32 bit coefficients, for primes p < 2^31,
+//   whose matrices take half the memory and bandwidth (see 'ntt_plan_bfly32_t')
+typedef struct {
+
+    // N, the number of points in the transform
+    int64_t N;
+
+    // p, the prime number related to the transform, such that:
+    //   p = Nk+1, and p < 2^31
+    uint32_t p;
+
+    // N^-1 (mod p)
+    uint32_t N_inv;
+
+    // the matrices for the forward and inverse NTT (size NxN), like 'ntt_plan_gemm_t'
+    uint32_t* mNTT;
+    uint32_t* mINTT;
+
+    // the (64 byte aligned) arena that all the matrices are allocated from
+    void* mem;
+
+} ntt_plan_gemm32_t;
+
+// generate the empty 32 bit GEMM-based plan
+#define NTT_PLAN_GEMM32_EMPTY ((ntt_plan_gemm32_t){ .N = 0, .p = 0, .mNTT = NULL, .mINTT = NULL, .mem = NULL })
+
+// Initialize a 32 bit GEMM-based plan, with 'N' points, mod 'p'
+// NOTE: p = Nk + 1 (and p < 2^31), or, if p==0, then 'p' is chosen like 'ntt_plan_gemm_init'
+void ntt_plan_gemm32_init(ntt_plan_gemm32_t* plan, int64_t N, uint32_t p);
+
+// Free the plan's matrices, leaving it empty (so it can be initialized again)
+void ntt_plan_gemm32_free(ntt_plan_gemm32_t* plan);
+
+// Do forward NTT:
+// out = NTT(inp)
+// NOTE: the inputs may be any 32 bit values
+void ntt_plan_gemm32_NTT(ntt_plan_gemm32_t* plan, uint32_t* inp, uint32_t* out);
+
+// Do inverse NTT (INTT):
+// out = INTT(inp)
+void ntt_plan_gemm32_INTT(ntt_plan_gemm32_t* plan, uint32_t* inp, uint32_t* out);
+
+
 // ntt_plan_bfly_t - plan for butterfly-based NTT codes
 typedef struct {
 
@@ -82,23 +167,112 @@ typedef struct {
     // N^-1 (mod p)
     int64_t N_inv;
 
-    // twiddle factors:
-    // W = 1, w, w^2, w^3, ... w^(n-1)
-    // W = 1, w^-1, w^-2, w^-3, ... w^(1-n)
-    // Where 'w' is an 'N'th root of unity
+    // twiddle factors, stored contiguously for each stage, so that the butterflies
+    //   always walk them with unit stride:
+    // W[m2 + i] = w_(2*m2)^i, for i < m2 (and m2 = 1, 2, 4, ... N/2)
+    // IW[m2 + i] = w_(2*m2)^-i
+    // Where 'w_m' is an 'm'th root of unity (so W[N/2:] = 1, w, w^2, ... w^(N/2-1)),
+    //   and W[0] = IW[0] = 1 is unused
+    // If N isn't a power of 2, the above is only for m2 < N_pow2, and the radix-3/5 stages on
+    //   blocks of length L = r * m use W[s * m + j] = w_L^(s * j), for 0 < s < r and j < m
     int64_t* W;
     int64_t* IW;
 
-    // bit reversed
-    int64_t* W_br;
+    // Shoup precomputed quotients for the twiddle factors, so that the
+    //   butterflies never have to divide:
+    // W_shoup[i] = floor(W[i] * 2^64 / p)
+    // IW_shoup[i] = floor(IW[i] * 2^64 / p)
+    uint64_t* W_shoup;
+    uint64_t* IW_shoup;
+
+    // floor(N_inv * 2^64 / p)
+    uint64_t N_inv_shoup;
+
+    // whether to use lazy (Harvey-style) reduction, which keeps coefficients in
+    //   the redundant range [0, 4p) between stages, and only fully reduces them
+    //   at the end. Can be set any time after initialization
+    // NOTE: only takes effect for p < 2^62, otherwise the exact path is used
+    bool lazy;
+
+    // which kernels to use, which is set to the best one for the current CPU on initialization
+    // NOTE: this can be lowered (for example, to compare against NTT_ISA_SCALAR), but not raised
+    //   above what the CPU supports. If the kernels can't handle 'p', the scalar ones are used
+    ntt_isa_t isa;
+
+    // the radix of the butterfly kernels, either 2 or 4 (the default), which fuses pairs
+    //   of stages to halve the number of passes over memory (with a single radix-2 stage
+    //   for odd log2(N)). Can be set any time after initialization
+    int radix;
+
+    // the number of threads each transform is split across (default: 1), which can be
+    //   changed any time after initialization
+    // NOTE: only transforms with N >= NTT_BFLY_MT_MIN_N are split, since smaller ones
+    //   are faster on a single thread
+    int nthreads;
+
+    // the twiddle tables (and Shoup quotients) for the batched transforms, with each
+    //   entry repeated for every lane (so, W_batch[i] = W[i / NTT_BFLY_BATCH_L]). These
+    //   are only allocated for N <= NTT_BFLY_BATCH_MAX_N (otherwise, they are NULL)
+    int64_t* W_batch;
+    int64_t* IW_batch;
+    uint64_t* W_batch_shoup;
+    uint64_t* IW_batch_shoup;
+
+    // the largest power of 2 which divides N. The rest of N (which must be 3^b * 5^c) is
+    //   done with radix-3 and radix-5 stages, before (DIF) or after (DIT) the power of 2 ones
+    int64_t N_pow2;
+
+    // constants for the radix-3 and radix-5 butterflies (if N has those factors), which use
+    //   the symmetry of the roots of unity to save multiplies:
+    // R3 = { -1/2, (w_3 - w_3^2)/2 }
+    // R5 = { (w_5 + w_5^4)/2, (w_5^2 + w_5^3)/2, (w_5 - w_5^4)/2, (w_5^2 - w_5^3)/2 }
+    // And IR3, IR5 are the same, but for the inverse roots
+    int64_t R3[2], IR3[2];
+    int64_t R5[4], IR5[4];
+
+    // the digit reversal permutation, if N isn't a power of 2 (otherwise, NULL): after the
+    //   DIF stages, position 'i' holds output perm[i] of the NTT
+    int64_t* perm;
+
+    // scratch buffer (of N elements) for the in place natural order transforms of the mixed
+    //   radix sizes, since the permutation can't be done in place (otherwise, NULL)
+    // NOTE: so, like 'ntt_plan_fourstep_t', those can't be run on the same plan from
+    //   multiple threads at once (out of place ones can)
+    int64_t* tmp;
+
+    // if 'p' is one of the primes given to './configure --ntt-primes', the index of the
+    //   precomputed root and pointwise kernel for it (with 'p' baked in), otherwise -1
+    int fixed;
+
+    // the (64 byte aligned) arena that all the tables are allocated from
+    void* mem;
 
 } ntt_plan_bfly_t;
 
-#define NTT_PLAN_BFLY_EMPTY ((ntt_plan_bfly_t){ .N = 0, .p = 0, .W = NULL, .IW = NULL, .W_br = NULL })
+#define NTT_PLAN_BFLY_EMPTY ((ntt_plan_bfly_t){ .N = 0, .p = 0, .W = NULL, .IW = NULL, .W_shoup = NULL, .IW_shoup = NULL, .lazy = false, .isa = NTT_ISA_SCALAR, .radix = 4, .nthreads = 1, .W_batch = NULL, .IW_batch = NULL, .W_batch_shoup = NULL, .IW_batch_shoup = NULL, .perm = NULL, .tmp = NULL, .fixed = -1, .mem = NULL })
+
+// the minimum size of a transform that is split across threads
+#define NTT_BFLY_MT_MIN_N (1 << 15)
 
-//
+// the number of transforms that the batched functions interleave, so that each SIMD lane
+//   works on a different transform
+#define NTT_BFLY_BATCH_L 8
+
+// the largest transform that the batched functions interleave (larger ones are just done
+//   one at a time, since they already fill the vectors)
+#define NTT_BFLY_BATCH_MAX_N 1024
+
+// Initialize a butterfly-based plan, with 'N' points, mod 'p'
+// NOTE: p = Nk + 1 (and p < 2^63), or, if p==0, then 'p' will be the largest prime of the
+//   form (Nk+1) below 2^30 (so the SIMD kernels can use it) from the built-in table (see
+//   'ntt_prime_lookup'), or if there's none, the smallest one
+// NOTE: N must be of the form 2^a * 3^b * 5^c (see 'ntt_smooth_size'), for other lengths,
+//   use 'ntt_plan_bluestein_t' (this, and 'p', are checked with 'assert')
 void ntt_plan_bfly_init(ntt_plan_bfly_t* plan, int64_t N, int64_t p);
 
+// Free the plan's tables, leaving it empty (so it can be initialized again)
+void ntt_plan_bfly_free(ntt_plan_bfly_t* plan);
+
 // Do forward NTT:
 // out = NTT(inp)
 void ntt_plan_bfly_NTT(ntt_plan_bfly_t* plan, int64_t* inp, int64_t* out);
@@ -107,53 +281,493 @@ void ntt_plan_bfly_NTT(ntt_plan_bfly_t* plan, int64_t* inp, int64_t* out);
 // out = INTT(inp)
 void ntt_plan_bfly_INTT(ntt_plan_bfly_t* plan, int64_t* inp, int64_t* out);
 
+// Do forward NTT (decimation-in-frequency), leaving the output in bit reversed order:
+// out = bitrev(NTT(inp))
+// NOTE: this skips the bit reversal permutation, so it is faster when the order of the
+//   result doesn't matter (for example, in convolutions)
+// NOTE: if N isn't a power of 2, the output is in digit reversed order (see 'perm') instead
+void ntt_plan_bfly_NTT_bitrev(ntt_plan_bfly_t* plan, int64_t* inp, int64_t* out);
+
+// Do inverse NTT (decimation-in-time), taking the input in bit reversed order:
+// out = INTT(bitrev(inp))
+// NOTE: this is the inverse of 'ntt_plan_bfly_NTT_bitrev', so they may be paired without
+//   any permutation
+void ntt_plan_bfly_INTT_bitrev(ntt_plan_bfly_t* plan, int64_t* inp, int64_t* out);
+
+// Do forward NTT like 'ntt_plan_bfly_NTT_bitrev', but where only the first 'n_in' inputs
+//   may be nonzero (the rest are treated as 0, and never read):
+// out = bitrev(NTT(inp[:n_in] + [0] * (N - n_in)))
+// NOTE: this skips the butterflies that only see zeros, which is useful for zero-padded
+//   inputs (for example, in convolutions, where n_in <= N/2)
+void ntt_plan_bfly_NTT_bitrev_pruned(ntt_plan_bfly_t* plan, int64_t* inp, int64_t n_in, int64_t* out);
+
+// Do inverse NTT like 'ntt_plan_bfly_INTT_bitrev', but only compute the first 'n_out' outputs:
+// out[:n_out] = INTT(bitrev(inp))[:n_out]
+// NOTE: 'out' must still have room for all N elements (since it is used as the work space),
+//   but only the first 'n_out' are valid afterwards
+void ntt_plan_bfly_INTT_bitrev_pruned(ntt_plan_bfly_t* plan, int64_t* inp, int64_t* out, int64_t n_out);
+
+// Do 'count' forward NTTs at once (like FFTW's advanced interface), where element 'j' of
+//   transform 'v' is:
+// inp[v * idist + j * istride], and the result is stored in out[v * odist + j * ostride]
+// NOTE: 'inp' and 'out' may be the same (with the same layout), and small transforms are
+//   interleaved so that the SIMD lanes each work on a different transform, which is much
+//   faster than calling 'ntt_plan_bfly_NTT' for each
+void ntt_plan_bfly_NTT_batch(ntt_plan_bfly_t* plan, int64_t count, int64_t* inp, int64_t istride, int64_t idist, int64_t* out, int64_t ostride, int64_t odist);
+
+// Do 'count' inverse NTTs at once, with the same layout as 'ntt_plan_bfly_NTT_batch'
+void ntt_plan_bfly_INTT_batch(ntt_plan_bfly_t* plan, int64_t count, int64_t* inp, int64_t istride, int64_t idist, int64_t* out, int64_t ostride, int64_t odist);
+
+
+
+// ntt_plan_bfly32_t - plan for butterfly-based NTT codes with 32 bit coefficients, for
+//   primes p < 2^31. This is the same algorithm as 'ntt_plan_bfly_t' (for N a power of 2),
+//   but the coefficients and twiddles take half the memory and bandwidth, and the SIMD
+//   kernels work on twice as many of them at once
+typedef struct {
+
+    // N, the number of points in the transform (which must be a power of 2)
+    int64_t N;
+
+    // p, the prime number related to the transform, such that:
+    //   p = Nk+1, and p < 2^31
+    uint32_t p;
+
+    // N^-1 (mod p), and floor(N_inv * 2^32 / p)
+    uint32_t N_inv;
+    uint32_t N_inv_shoup;
+
+    // twiddle factors, with the same stage-contiguous layout as 'ntt_plan_bfly_t':
+    // W[m2 + i] = w_(2*m2)^i, for i < m2
+    // IW[m2 + i] = w_(2*m2)^-i
+    uint32_t* W;
+    uint32_t* IW;
+
+    // 32 bit Shoup precomputed quotients for the twiddle factors:
+    // W_shoup[i] = floor(W[i] * 2^32 / p)
+    // IW_shoup[i] = floor(IW[i] * 2^32 / p)
+    uint32_t* W_shoup;
+    uint32_t* IW_shoup;
+
+    // whether to use lazy reduction, which keeps coefficients in [0, 4p) between stages.
+    //   Can be set any time after initialization
+    // NOTE: only takes effect for p < 2^30 (so that 4p fits in 32 bits)
+    bool lazy;
+
+    // which kernels to use, which is set to the best one for the current CPU on initialization
+    //   (see 'ntt_plan_bfly_t')
+    ntt_isa_t isa;
+
+    // the radix of the butterfly kernels, either 2 or 4 (the default)
+    int radix;
+
+    // the number of threads each transform is split across (default: 1), for
+    //   N >= NTT_BFLY_MT_MIN_N (see 'ntt_plan_bfly_t')
+    int nthreads;
+
+    // the (64 byte aligned) arena that all the tables are allocated from
+    void* mem;
+
+} ntt_plan_bfly32_t;
+
+#define NTT_PLAN_BFLY32_EMPTY ((ntt_plan_bfly32_t){ .N = 0, .p = 0, .W = NULL, .IW = NULL, .W_shoup = NULL, .IW_shoup = NULL, .lazy = false, .isa = NTT_ISA_SCALAR, .radix = 4, .nthreads = 1, .mem = NULL })
+
+// Initialize a 32 bit butterfly-based plan, with 'N' points, mod 'p'
+// NOTE: p = Nk + 1 (and p < 2^31), or, if p==0, then 'p' is chosen like 'ntt_plan_bfly_init'
+//   (N, and 'p', are checked with 'assert')
+void ntt_plan_bfly32_init(ntt_plan_bfly32_t* plan, int64_t N, uint32_t p);
+
+// Free the plan's tables, leaving it empty (so it can be initialized again)
+void ntt_plan_bfly32_free(ntt_plan_bfly32_t* plan);
+
+// Do forward NTT:
+// out = NTT(inp)
+// NOTE: the inputs may be any 32 bit values (they are reduced mod p first)
+void ntt_plan_bfly32_NTT(ntt_plan_bfly32_t* plan, uint32_t* inp, uint32_t* out);
+
+// Do inverse NTT (INTT):
+// out = INTT(inp)
+void ntt_plan_bfly32_INTT(ntt_plan_bfly32_t* plan, uint32_t* inp, uint32_t* out);
+
+// Do forward NTT, leaving the output in bit reversed order (see 'ntt_plan_bfly_NTT_bitrev'):
+// out = bitrev(NTT(inp))
+void ntt_plan_bfly32_NTT_bitrev(ntt_plan_bfly32_t* plan, uint32_t* inp, uint32_t* out);
+
+// Do inverse NTT, taking the input in bit reversed order (see 'ntt_plan_bfly_INTT_bitrev'):
+// out = INTT(bitrev(inp))
+void ntt_plan_bfly32_INTT_bitrev(ntt_plan_bfly32_t* plan, uint32_t* inp, uint32_t* out);
+
+
+
+// the "Goldilocks" prime, 2^64 - 2^32 + 1, which has 2^32'th roots of unity, and a special
+//   form that makes reduction modulo it just shifts and adds
+#define NTT_GL_P 0xFFFFFFFF00000001ULL
+
+// ntt_plan_gl_t - plan for butterfly-based NTT codes modulo the Goldilocks prime (NTT_GL_P).
+//   This is too large for the 'int64_t' plans, but one transform mod it carries about as
+//   much as 2-3 of the smaller primes do, and its special form makes the reductions cheap
+//   enough that no Shoup quotients are needed
+typedef struct {
+
+    // N, the number of points in the transform (which must be a power of 2, <= 2^32)
+    int64_t N;
+
+    // N^-1 (mod p)
+    uint64_t N_inv;
+
+    // twiddle factors, with the same stage-contiguous layout as 'ntt_plan_bfly_t':
+    // W[m2 + i] = w_(2*m2)^i, for i < m2
+    // IW[m2 + i] = w_(2*m2)^-i
+    uint64_t* W;
+    uint64_t* IW;
+
+    // the number of threads each transform is split across (default: 1), for
+    //   N >= NTT_BFLY_MT_MIN_N (see 'ntt_plan_bfly_t')
+    int nthreads;
+
+    // the (64 byte aligned) arena that all the tables are allocated from
+    void* mem;
+
+} ntt_plan_gl_t;
+
+#define NTT_PLAN_GL_EMPTY ((ntt_plan_gl_t){ .N = 0, .N_inv = 0, .W = NULL, .IW = NULL, .nthreads = 1, .mem = NULL })
+
+// Initialize a Goldilocks plan, with 'N' points
+void ntt_plan_gl_init(ntt_plan_gl_t* plan, int64_t N);
+
+// Free the plan's tables, leaving it empty (so it can be initialized again)
+void ntt_plan_gl_free(ntt_plan_gl_t* plan);
+
+// Do forward NTT:
+// out = NTT(inp)
+// NOTE: the inputs may be any 64 bit values (they are reduced mod p first)
+void ntt_plan_gl_NTT(ntt_plan_gl_t* plan, uint64_t* inp, uint64_t* out);
+
+// Do inverse NTT (INTT):
+// out = INTT(inp)
+void ntt_plan_gl_INTT(ntt_plan_gl_t* plan, uint64_t* inp, uint64_t* out);
+
+// Do forward NTT, leaving the output in bit reversed order (see 'ntt_plan_bfly_NTT_bitrev'):
+// out = bitrev(NTT(inp))
+void ntt_plan_gl_NTT_bitrev(ntt_plan_gl_t* plan, uint64_t* inp, uint64_t* out);
+
+// Do inverse NTT, taking the input in bit reversed order (see 'ntt_plan_bfly_INTT_bitrev'):
+// out = INTT(bitrev(inp))
+void ntt_plan_gl_INTT_bitrev(ntt_plan_gl_t* plan, uint64_t* inp, uint64_t* out);
+
+
+
+// ntt_plan_fourstep_t - plan for four-step (Bailey's) NTT codes, which split the transform
+//   into sub-transforms small enough to stay in cache. This is faster than the butterfly
+//   plan once N is much larger than the L2/L3 cache
+typedef struct {
+
+    // N, the number of points in the transform
+    int64_t N;
+
+    // p, the prime number related to the transform, such that:
+    //   p = Nk+1
+    int64_t p;
+
+    // N^-1 (mod p)
+    int64_t N_inv;
+
+    // N = N1 * N2, where the input is treated as an N1 x N2 matrix (row-major)
+    int64_t N1, N2;
+
+    // butterfly plans for the sub-transforms of size N1 and N2
+    ntt_plan_bfly_t plan_N1, plan_N2;
+
+    // twiddle factors applied between the passes (and their Shoup quotients):
+    // W[n2 * N1 + k1] = w^(n2 * k1)
+    // IW[n2 * N1 + k1] = w^-(n2 * k1)
+    int64_t* W;
+    int64_t* IW;
+    uint64_t* W_shoup;
+    uint64_t* IW_shoup;
+
+    // scratch buffer (of N elements) for the transposes
+    int64_t* tmp;
+
+    // the (64 byte aligned) arena that all the tables are allocated from
+    void* mem;
+
+} ntt_plan_fourstep_t;
+
+#define NTT_PLAN_FOURSTEP_EMPTY ((ntt_plan_fourstep_t){ .N = 0, .p = 0, .plan_N1 = NTT_PLAN_BFLY_EMPTY, .plan_N2 = NTT_PLAN_BFLY_EMPTY, .W = NULL, .IW = NULL, .W_shoup = NULL, .IW_shoup = NULL, .tmp = NULL, .mem = NULL })
+
+// Initialize a four-step plan, with 'N' points, mod 'p'
+// NOTE: N must be of the form 2^a * 3^b * 5^c, like 'ntt_plan_bfly_init', and is split into
+//   N1 * N2, where N1 is the largest divisor of N that is at most sqrt(N)
+// NOTE: p = Nk + 1 (and p < 2^63), or, if p==0, then 'p' is chosen like 'ntt_plan_bfly_init'
+void ntt_plan_fourstep_init(ntt_plan_fourstep_t* plan, int64_t N, int64_t p);
+
+// Free the plan's tables (and its sub-plans), leaving it empty (so it can be initialized again)
+void ntt_plan_fourstep_free(ntt_plan_fourstep_t* plan);
+
+// Do forward NTT:
+// out = NTT(inp)
+void ntt_plan_fourstep_NTT(ntt_plan_fourstep_t* plan, int64_t* inp, int64_t* out);
+
+// Do inverse NTT (INTT):
+// out = INTT(inp)
+void ntt_plan_fourstep_INTT(ntt_plan_fourstep_t* plan, int64_t* inp, int64_t* out);
+
+
+// ntt_plan_bluestein_t - plan for Bluestein's (chirp-z) NTT, which works for any N
+//   (not just 2^a * 3^b * 5^c), by turning the transform into a convolution of size M
+typedef struct {
+
+    // N, the number of points in the transform
+    int64_t N;
+
+    // p, the prime number related to the transform, such that:
+    //   p = 2Nk+1, and also p = Mk'+1
+    int64_t p;
+
+    // N^-1 (mod p)
+    int64_t N_inv;
+
+    // size of the convolution (the smallest power of 2 >= 2N - 1)
+    int64_t M;
+
+    // butterfly plan for the convolution
+    ntt_plan_bfly_t plan_M;
+
+    // the chirp (and its Shoup quotients):
+    // C[j] = w_2N^(j^2), where w_2N^2 is the root of unity of the transform
+    // IC[j] = C[j]^-1
+    int64_t* C;
+    int64_t* IC;
+    uint64_t* C_shoup;
+    uint64_t* IC_shoup;
+
+    // the transformed filters (in bit reversed order), which are the chirp inverses for the
+    //   forward transform, and the chirps for the inverse (with N^-1 folded in)
+    int64_t* B;
+    int64_t* IB;
+    uint64_t* B_shoup;
+    uint64_t* IB_shoup;
+
+    // scratch buffer (of M elements) for the convolution
+    // NOTE: so, like 'ntt_plan_fourstep_t', a plan can't be run from multiple threads at once
+    int64_t* tmp;
+
+    // the (64 byte aligned) arena that all the tables are allocated from
+    void* mem;
+
+} ntt_plan_bluestein_t;
+
+#define NTT_PLAN_BLUESTEIN_EMPTY ((ntt_plan_bluestein_t){ .N = 0, .p = 0, .plan_M = NTT_PLAN_BFLY_EMPTY, .C = NULL, .IC = NULL, .C_shoup = NULL, .IC_shoup = NULL, .B = NULL, .IB = NULL, .B_shoup = NULL, .IB_shoup = NULL, .tmp = NULL, .mem = NULL })
+
+// Initialize a Bluestein plan, with 'N' points, mod 'p'
+// NOTE: p = 2Nk + 1 and p = Mk' + 1 (and p < 2^63), or, if p==0, then 'p' is chosen like
+//   'ntt_plan_bfly_init' (but for both of those)
+void ntt_plan_bluestein_init(ntt_plan_bluestein_t* plan, int64_t N, int64_t p);
+
+// Free the plan's tables (and the convolution plan), leaving it empty (so it can be initialized again)
+void ntt_plan_bluestein_free(ntt_plan_bluestein_t* plan);
+
+// Do forward NTT:
+// out = NTT(inp)
+void ntt_plan_bluestein_NTT(ntt_plan_bluestein_t* plan, int64_t* inp, int64_t* out);
+
+// Do inverse NTT (INTT):
+// out = INTT(inp)
+void ntt_plan_bluestein_INTT(ntt_plan_bluestein_t* plan, int64_t* inp, int64_t* out);
 
 
 // ntt_multer_t - helper class for multiplying 2 sequences
 typedef struct {
 
-    // N, the size of each input (may be rounded to a power of 2)
+    // N, the size of each input (rounded up to the next 2^k, 3 * 2^k or 5 * 2^k)
     int64_t N;
 
-    // product of all 'p''s from the plans
+    // the width of each limb (word) of the inputs, which are all < 2^limb_bits, and how many
+    //   limbs the inputs 'A' and 'B' have (for 'ntt_multer_init_bits', otherwise just 'N')
+    int limb_bits;
+    int64_t nA, nB;
+
+    // the kernels that the primes were chosen for (see 'ntt_multer_init_bits')
+    ntt_isa_t isa;
+
+    // product of all 'p''s from the plans (or 0 if it doesn't fit in an 'int64_t', or if
+    //   'use_gl')
     int64_t prod_p;
 
-    // number of NTT-plans for multiplication
+    // number of NTT-plans for multiplication (one per prime)
     int n_plans;
 
-    // array of plans
-    ntt_plan_bfly_t* plans;
-
-    // CRT (Chinese Remainder Theorem) data for each 'p' for each plan
-    struct {
+    // the primes, 'primes[i]' for the i'th plan
+    int64_t* primes;
 
-        // Ni = prod_p / p
-        int64_t Ni;
+    // array of plans, which are either 64 bit ('plans'), or, when every prime is < 2^31 and N
+    //   is a power of 2, 32 bit ('plans32', which halves the memory traffic of the transforms),
+    //   and the other is NULL
+    ntt_plan_bfly_t* plans;
+    ntt_plan_bfly32_t* plans32;
 
-        // d = Ni^-1 (mod p)
-        int64_t d;
+    // if true (from 'ntt_multer_init_gl'), there are no 'plans', and a single plan mod the
+    //   Goldilocks prime is used instead, which needs no CRT
+    bool use_gl;
+    ntt_plan_gl_t gl;
 
-    }* CRT_p;
+    // CRT (Chinese Remainder Theorem) data, for Garner's algorithm, which for each pair of
+    //   plans j < i has CRT_inv[i * n_plans + j] = p_j^-1 (mod p_i), and its Shoup quotient
+    int64_t* CRT_inv;
+    uint64_t* CRT_inv_shoup;
 
 
-    // temp buffers for NTTs
+    // temp buffers for NTTs (one per plan), where the product is computed in place in 'nttA',
+    //   and 'nttB' is only allocated for multiplies that aren't squarings
     int64_t** nttA;
     int64_t** nttB;
-    int64_t** nttC;
-    int64_t** C;
+
+    // with 'plans32', the transforms are done in these 'uint32_t' buffers instead (and the
+    //   'nttB' ones aren't allocated), and 'nttA' just gets the coefficients, which are
+    //   widened after the inverse transforms
+    uint32_t** nttA32;
+    uint32_t** nttB32;
+
+    // the (64 byte aligned) arenas that the buffers (and CRT data) are allocated from, where
+    //   'nttB' has its own, since it's allocated later
+    void* mem;
+    void* mem_B;
 
 } ntt_multer_t;
 
 
 // empty multiplier
-#define NTT_MULTER_EMPTY ((ntt_multer_t){ .N = 0, .plans = NULL, .n_plans = 0, .nttA = NULL, .nttB = NULL, .nttC = NULL })
+#define NTT_MULTER_EMPTY ((ntt_multer_t){ .N = 0, .limb_bits = 0, .nA = 0, .nB = 0, .isa = NTT_ISA_SCALAR, .primes = NULL, .plans = NULL, .plans32 = NULL, .n_plans = 0, .use_gl = false, .gl = NTT_PLAN_GL_EMPTY, .CRT_inv = NULL, .CRT_inv_shoup = NULL, .nttA = NULL, .nttB = NULL, .nttA32 = NULL, .nttB32 = NULL, .mem = NULL, .mem_B = NULL })
 
-// Create a multiplyer
+// Create a multiplyer, for inputs of (at least) 'N' elements (see 'multer->N' for the
+//   actual size), which are all < 2^8
+// NOTE: 'multer' must be NTT_MULTER_EMPTY, or a previous multiplier (which is freed first),
+//   for all of the 'ntt_multer_init*' functions
 void ntt_multer_init(ntt_multer_t* multer, int64_t N);
 
+// Create a multiplier for integers of (at most) 'bitsA' and 'bitsB' bits, which picks the limb
+//   width ('multer->limb_bits', 8, 16, 24 or 32), and the fewest, largest primes such that every
+//   coefficient of the product, (2^limb_bits - 1)^2 * min(nA, nB), is below their product
+// The inputs should be split into 'multer->nA' and 'multer->nB' limbs (least significant
+//   first), and passed to 'ntt_multer_mult_limbs'
+// NOTE: if one operand is much larger than the other, 'multer->N' may be picked for just a
+//   few times the smaller one, and then 'ntt_multer_mult_limbs' does the product in chunks
+// 'target' is the kernel to choose the primes for (below 2^30 for AVX2 and AVX-512, 2^50 for
+//   IFMA, or 2^62 for scalar), which should usually be 'ntt_isa_detect()'
+// NOTE: it is checked with 'assert' that some set of primes was found
+void ntt_multer_init_bits(ntt_multer_t* multer, int64_t bitsA, int64_t bitsB, ntt_isa_t target);
+
+// Create a multiplier like 'ntt_multer_init', but which uses a single transform modulo the
+//   Goldilocks prime (see 'ntt_plan_gl_t') instead of 2-3 smaller primes and a CRT
+// NOTE: 'multer->N' is always a power of 2 (<= 2^32) for these
+void ntt_multer_init_gl(ntt_multer_t* multer, int64_t N);
+
+// Free the multiplier's plans and buffers, leaving it empty
+void ntt_multer_free(ntt_multer_t* multer);
+
 // Set 'C = A * B' through convolution
 void ntt_multer_mult(ntt_multer_t* multer, int64_t* A, int64_t* B, int64_t* C);
 
+// Set 'C = A * B' like 'ntt_multer_mult', but where only the first 'nA' elements of 'A' and
+//   'nB' elements of 'B' are given (the rest are treated as 0), and only the first 'nC'
+//   elements of 'C' are computed
+// NOTE: this skips the parts of the transforms that only touch the zero padding, or the
+//   unneeded outputs. The full product needs nC = nA + nB - 1 <= N (and nC <= N is checked
+//   with 'assert')
+// NOTE: the coefficients of 'C' have to fit in an 'int64_t' (which they always do for
+//   'ntt_multer_init'), otherwise use 'ntt_multer_mult_limbs'
+void ntt_multer_mult_pruned(ntt_multer_t* multer, int64_t* A, int64_t nA, int64_t* B, int64_t nB, int64_t* C, int64_t nC);
+
+// Set 'C = A * A' like 'ntt_multer_mult_pruned', but with a single forward transform per prime
+// NOTE: the other multiplies also do this when they're passed the same 'A' and 'B' (and 'nA'
+//   and 'nB'), and the buffers for 'B' are never allocated if they never get different ones
+void ntt_multer_sqr(ntt_multer_t* multer, int64_t* A, int64_t nA, int64_t* C, int64_t nC);
+
+// Set 'C = A * B' like 'ntt_multer_mult_pruned', but for integers 'A' and 'B' in limbs of
+//   'multer->limb_bits' bits (least significant first), so the carries are propagated, and
+//   'C' is the product in 'nC' limbs (mod 2^(nC * limb_bits)). The full product needs
+//   nC = nA + nB
+// The coefficients are reconstructed with multiple words, so this works for any number of
+//   primes (and any limb width)
+// NOTE: if the product doesn't fit in 'N' coefficients (after dropping the limbs of 'A' and
+//   'B' past 'nC'), then the smaller operand is transformed once and slid across the larger
+//   one in chunks of N - min(nA, nB) + 1 limbs, whose products are added together
+//   (overlap-add). If neither operand fits, the smaller one is also split into pieces
+void ntt_multer_mult_limbs(ntt_multer_t* multer, int64_t* A, int64_t nA, int64_t* B, int64_t nB, int64_t* C, int64_t nC);
+
+// Set 'C' to the middle product of 'A' and 'B' (nA >= nB), which is the nA - nB + 1
+//   coefficients [nB - 1, nA) of 'A * B' (the ones that every element of 'B' contributes to)
+// These are exactly the coefficients that a cyclic convolution of just nA points doesn't
+//   wrap onto, so this only needs multer->N >= nA (instead of nA + nB - 1), which is what
+//   Newton iterations for reciprocals and division need (and is checked with 'assert')
+void ntt_multer_mulmid(ntt_multer_t* multer, int64_t* A, int64_t nA, int64_t* B, int64_t nB, int64_t* C);
+
+// Set 'C' to the short (high) product of 'A' and 'B', which is the top 'nC' coefficients
+//   [nA + nB - 1 - nC, nA + nB - 1) of 'A * B' (nC <= nA + nB - 1)
+// Only the top 'nC' elements of 'A' and 'B' touch these, so this only needs
+//   multer->N >= min(nA, nC) + min(nB, nC) - 1 (both of these are checked with 'assert')
+// NOTE: a cyclic convolution any smaller would wrap the low coefficients onto these, so
+//   for the high half of a balanced product, this is the same size as the full one (use
+//   'ntt_multer_mulmid' when the low part of the result isn't needed, like in Newton
+//   iterations)
+void ntt_multer_mulhigh(ntt_multer_t* multer, int64_t* A, int64_t nA, int64_t* B, int64_t nB, int64_t* C, int64_t nC);
+
+
+// ntt_multer_prep_t - an operand that has already been transformed by a multiplier, for
+//   multiplying many different values by the same one (see 'ntt_multer_prepare')
+typedef struct {
+
+    // the size of the multiplier it was prepared with
+    int64_t N;
+
+    // the number of transforms (one per plan of the multiplier, or 1 if 'use_gl')
+    int n_ntt;
+
+    // the transforms, in bit reversed order (or, for a multiplier with 'plans32', in 'ntt32',
+    //   and 'ntt' is NULL)
+    int64_t** ntt;
+    uint32_t** ntt32;
+
+    // the (64 byte aligned) arena that the transforms are allocated from
+    void* mem;
+
+} ntt_multer_prep_t;
+
+// empty prepared operand
+#define NTT_MULTER_PREP_EMPTY ((ntt_multer_prep_t){ .N = 0, .n_ntt = 0, .ntt = NULL, .ntt32 = NULL, .mem = NULL })
+
+// Transform 'B' (of 'nB' elements) once, into 'prep', so that it can be multiplied by with
+//   'ntt_multer_mult_prepared', which then only needs one forward and one inverse transform
+//   per prime
+// NOTE: 'prep' can only be used with the multiplier that prepared it (or one initialized the
+//   same way), and can be prepared again, with a different 'B'
+void ntt_multer_prepare(ntt_multer_t* multer, int64_t* B, int64_t nB, ntt_multer_prep_t* prep);
+
+// Free the prepared operand's transforms, leaving it empty
+void ntt_multer_prep_free(ntt_multer_prep_t* prep);
+
+// Set 'C = A * B' like 'ntt_multer_mult_pruned', where 'prepB' is from 'ntt_multer_prepare'
+void ntt_multer_mult_prepared(ntt_multer_t* multer, int64_t* A, int64_t nA, ntt_multer_prep_t* prepB, int64_t* C, int64_t nC);
+
+// Set 'C = A * B' like 'ntt_multer_mult_limbs', where 'prepB' is from 'ntt_multer_prepare'
+// NOTE: this isn't done in chunks, so the product has to fit (nA + nB - 1 <= N, where 'nB' is
+//   the length that was prepared)
+void ntt_multer_mult_prepared_limbs(ntt_multer_t* multer, int64_t* A, int64_t nA, ntt_multer_prep_t* prepB, int64_t* C, int64_t nC);
+
+
+/* CPU utils */
+
+// Detect the best instruction set (for NTT kernels) that the current CPU supports
+NTT_API ntt_isa_t ntt_isa_detect();
+
+// Return the number of threads available for parallel work (1 if built without OpenMP)
+NTT_API int ntt_num_threads();
+
+// Set how the large tables and buffers are allocated, for everything initialized after this
+// NOTE: huge pages cut the TLB misses of large transforms, but only matter on Linux
+NTT_API void ntt_set_hugepages(ntt_hugepages_t mode);
+
 
 /* NTT NT utils */
 
@@ -169,7 +783,7 @@ NTT_API int64_t ntt_egcd(int64_t a, int64_t b, int64_t* xy);
 // NOTE: Returns '0' if 'a' is not invertible (mod N)
 NTT_API int64_t ntt_modinv(int64_t a, int64_t N);
 
-// Calculate a*b (mod m)
+// Calculate a*b (mod m), for any 64 bit 'a', 'b' and 'm' (m > 0)
 NTT_API uint64_t ntt_modmul(uint64_t a, uint64_t b, uint64_t m);
 
 // Compute a^b (mod N) (always returning positive)
@@ -178,8 +792,9 @@ NTT_API uint64_t ntt_modmul(uint64_t a, uint64_t b, uint64_t m);
 NTT_API int64_t ntt_modpow(int64_t a, int64_t b, int64_t m);
 
 // Return whether or not 'a' is a prime number
-// NOTE: Uses a deterministic variant of the miller-rabin test, and so should be fairly fast
-NTT_API bool ntt_isprime(int64_t a);
+// NOTE: Uses a deterministic variant of the miller-rabin test (which is exact for every
+//   64 bit 'a'), and so should be fairly fast
+NTT_API bool ntt_isprime(uint64_t a);
 
 // Compute Euler's Totient function (phi(n))
 NTT_API int64_t ntt_tot(int64_t n);
@@ -188,15 +803,32 @@ NTT_API int64_t ntt_tot(int64_t n);
 // Compute the first root of unity, w, such that:
 // w^i != 1 for i = 1 through phi(n), but that w^phi(n) = 1 (mod n)
 // Or, returns '0' if there was no root of unity
+// NOTE: the primes in the built-in table (see 'ntt_prime_lookup') are just looked up
+// NOTE: if 'n' is prime, only the odd part of n-1 needs factoring (which, for NTT primes
+//   kN+1, is just the small cofactor of the power of 2)
 NTT_API int64_t ntt_prim_root_unity(int64_t n);
 
 
-// Compute an 'nth' root ofunity modulo p
+// Compute an 'nth' root of unity modulo p, which is primitive if 'p' is prime (or '0' if
+//   there is none, i.e. 'n' doesn't divide p-1)
 NTT_API int64_t ntt_nth_root_unity(int64_t n, int64_t p);
 
+// Return the largest prime p < 2^bits with p = 1 (mod N) (i.e. which has N'th roots of
+//   unity) from the table built by './configure', skipping the first 'skip' such primes (so
+//   skip=1 gives the second largest, and so on), and set '*g' to a primitive root of it (if
+//   'g' isn't NULL). Returns 0 if there is no such prime in the table
+// NOTE: the table has the largest few primes p = 1 (mod 2^k) below 2^30 (the limit of the
+//   SIMD kernels), 2^31, 2^32, 2^50 (IFMA), 2^62 and 2^63, for each k <= 40
+NTT_API int64_t ntt_prime_lookup(int64_t N, int bits, int skip, int64_t* g);
+
+// Return the smallest number >= n of the form 2^a * 3^b * 5^c, which is a valid
+//   length for the butterfly plans
+NTT_API int64_t ntt_smooth_size(int64_t n);
+
 /* Advanced utils like factoring */
 
 // Factor a number 'n', but return unique unsorted prime factors (UUP)
+// NOTE: small factors are found by trial division, and the rest by Pollard's rho
 // Return the number of factors, and set (*facts)[:] to the factors
 // NOTE: *facts can be NULL, and will be allocated using 'realloc',
 //   so only use 'free' with it afterwards
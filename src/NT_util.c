@@ -54,11 +54,69 @@ int64_t ntt_modinv(int64_t a, int64_t N) {
 
 // Calculate a*b (mod m)
 uint64_t ntt_modmul(uint64_t a, uint64_t b, uint64_t m) {
-    int64_t res = 0;
-    while (a != 0) {
-        if (a & 1) res = (res + b) % m;
-        a >>= 1;
-        b = (b << 1) % m;
+    // the full product always fits, so this is a single (128 by 64 bit) division
+    return (uint64_t)(((unsigned __int128)a * b) % m);
+}
+
+
+// Montgomery form (mod an odd 'm'), where 'x' is stored as x * 2^64 (mod m). Then products
+//   can be reduced with 2 multiplies, instead of a division, which is much faster for long
+//   chains of them (i.e. 'ntt_modpow')
+typedef struct {
+
+    uint64_t m;
+
+    // m^-1 (mod 2^64)
+    uint64_t m_inv;
+
+    // 2^128 (mod m), for converting into Montgomery form
+    uint64_t r2;
+
+} mont_t;
+
+static mont_t mont_init(uint64_t m) {
+    mont_t M;
+    M.m = m;
+
+    // Newton's iteration doubles the number of correct bits each step, starting from 3
+    //   (since m*m = 1 (mod 8) for any odd 'm')
+    uint64_t x = m;
+    int i;
+    for (i = 0; i < 5; ++i) x *= 2 - m * x;
+    M.m_inv = x;
+
+    // 2^64 (mod m), squared
+    uint64_t r = (0 - m) % m;
+    M.r2 = ntt_modmul(r, r, m);
+    return M;
+}
+
+// Montgomery reduction: T * 2^-64 (mod m), for T < m * 2^64
+static inline uint64_t mont_redc(const mont_t* M, unsigned __int128 T) {
+    // T - q*m is a multiple of 2^64, so its high half is just the difference of the high halves
+    uint64_t q = (uint64_t)T * M->m_inv;
+    uint64_t h = (uint64_t)(((unsigned __int128)q * M->m) >> 64);
+    uint64_t t = (uint64_t)(T >> 64);
+    return t >= h ? t - h : t - h + M->m;
+}
+
+// a*b for a, b in Montgomery form
+static inline uint64_t mont_mul(const mont_t* M, uint64_t a, uint64_t b) {
+    return mont_redc(M, (unsigned __int128)a * b);
+}
+
+// convert 'x' (< m) into Montgomery form
+static inline uint64_t mont_to(const mont_t* M, uint64_t x) {
+    return mont_redc(M, (unsigned __int128)x * M->r2);
+}
+
+// a^b, for 'a' in Montgomery form (and the result also in it)
+static uint64_t mont_pow(const mont_t* M, uint64_t a, uint64_t b) {
+    uint64_t res = mont_to(M, 1);
+    while (b > 0) {
+        if (b & 1) res = mont_mul(M, res, a);
+        a = mont_mul(M, a, a);
+        b >>= 1;
     }
     return res;
 }
@@ -77,14 +135,17 @@ int64_t ntt_modpow(int64_t a, int64_t b, int64_t m) {
         a %= m;
         if (a < 0) a += m;
 
+        if (m % 2 == 1 && m > 1) {
+            // (the usual case, since 'm' is almost always prime)
+            mont_t M = mont_init(m);
+            return mont_redc(&M, mont_pow(&M, mont_to(&M, a), b));
+        }
+
         // result
-        int64_t res = 1;
+        int64_t res = 1 % m;
 
         // now, calculate using repeated squaring
         while (b > 0) {
-            /*if (m == 4309503329) {
-                printf("%lli::%lli,%lli\n", res, a, b);
-            }*/
             if (b % 2 == 1) {
                 // multiply by active bit
                 res = ntt_modmul(res, a, m);
@@ -95,42 +156,34 @@ int64_t ntt_modpow(int64_t a, int64_t b, int64_t m) {
             b /= 2;
         }
 
-        // ensure result is positive
-        if (res < 0) res += m;
         return res;
     }
 }
 
-/// Internal miller rabin trial test
-static bool i_milrab(int64_t n, int64_t a) {
-
-
-    if (n % a == 0) return false;
+/// Internal miller rabin trial test, for n - 1 = 2^r * d (with 'd' odd)
+static bool i_milrab(const mont_t* M, uint64_t a, uint64_t d, int r) {
+    uint64_t n = M->m;
 
-    // Decompose: n = 2^r * d + 1
-    int64_t r = 0;
-    int64_t d = n - 1;
+    // bases that are multiples of 'n' tell us nothing
+    a %= n;
+    if (a == 0) return true;
 
-    // take out powers of 2
-    while (d % 2 == 0) {
-        r++;
-        d /= 2;
-    }
+    // 1 and -1, in Montgomery form
+    uint64_t one = mont_to(M, 1), neg_one = n - one;
 
     // calculate a^d (mod n)
-    int64_t x = ntt_modpow(a, d, n);
+    uint64_t x = mont_pow(M, mont_to(M, a), d);
 
-    if (x == 1 || x == n - 1) {
+    if (x == one || x == neg_one) {
         // still might be prime
         return true;
     } else {
-        int64_t i;
+        int i;
         // complete the test 'r-1' times
         for (i = 0; i < r - 1; ++i) {
-            x = ntt_modmul(x, x, n);
+            x = mont_mul(M, x, x);
             // still might be prime
-
-            if (x == n - 1) return true;
+            if (x == neg_one) return true;
         }
         // not prime, definitely composite
         return false;
@@ -138,47 +191,127 @@ static bool i_milrab(int64_t n, int64_t a) {
 }
 
 // Return 0 if 'val' is composite, non-zero if 'val' is prime
-bool ntt_isprime(int64_t val) {
-    // special cases
+bool ntt_isprime(uint64_t val) {
+    // trial division by small primes first, which handles all the small cases
+    static const uint64_t small[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+    int i;
     if (val < 2) return 0;
-    if (val < 4 || val == 5) return 1;
-    if (val % 2 == 0 || val % 3 == 0) return 0;
-
-    /**/ if (val < 2047) return i_milrab(val, 2);
-    else if (val < 1373653) return i_milrab(val, 2) && i_milrab(val, 3);
-    else if (val < 9080191) return i_milrab(val, 31) && i_milrab(val, 73);
-    else if (val < 25326001) return i_milrab(val, 2) && i_milrab(val, 3) && i_milrab(val, 5);
-    else if (val < 3215031751UL) return i_milrab(val, 2) && i_milrab(val, 3) && i_milrab(val, 5) && i_milrab(val, 7);
-    else if (val < 4759123141UL) return i_milrab(val, 2) && i_milrab(val, 7) && i_milrab(val, 61);
-    else if (val < 1122004669633UL) return i_milrab(val, 2) && i_milrab(val, 13) && i_milrab(val, 23) && i_milrab(val, 1662803);
-    else if (val < 2152302898747UL) return i_milrab(val, 2) && i_milrab(val, 3) && i_milrab(val, 5) && i_milrab(val, 7) && i_milrab(val, 11);
-    else if (val < 3474749660383UL) return i_milrab(val, 2) && i_milrab(val, 3) && i_milrab(val, 5) && i_milrab(val, 7) && i_milrab(val, 11) && i_milrab(val, 13);
-    else if (val < 341550071728321UL) return i_milrab(val, 2) && i_milrab(val, 3) && i_milrab(val, 5) && i_milrab(val, 7) && i_milrab(val, 11) && i_milrab(val, 13) && i_milrab(val, 17);
-    else {
-        // assume not prime
-        return 0;
+    for (i = 0; i < (int)(sizeof(small) / sizeof(*small)); ++i) {
+        if (val == small[i]) return 1;
+        if (val % small[i] == 0) return 0;
+    }
+    if (val < 37 * 37) return 1;
+
+    // Decompose: val = 2^r * d + 1
+    uint64_t d = val - 1;
+    int r = 0;
+    while (d % 2 == 0) {
+        r++;
+        d /= 2;
+    }
+
+    // these 7 bases (found by Jim Sinclair) are enough for every 64 bit 'val'
+    static const uint64_t bases[] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+    mont_t M = mont_init(val);
+    for (i = 0; i < 7; ++i) {
+        if (!i_milrab(&M, bases[i], d, r)) return 0;
     }
+    return 1;
 }
 
 // Compute Euler's totient function of 'n'
 int64_t ntt_tot(int64_t n) {
-	int64_t tot = n, i;
+    int64_t tot = n, i;
+
+    int64_t* facts = NULL;
+    int64_t nfacs = ntt_factor_uup(n, &facts);
+    for (i = 0; i < nfacs; ++i) {
+        tot -= tot / facts[i];
+    }
+
+    free(facts);
+    return tot;
+}
+
+
+// trial divide by everything up to this before using Pollard's rho
+#define I_TRIAL_MAX 1024
+
+// gcd of unsigned 'a' and 'b'
+static uint64_t i_gcd(uint64_t a, uint64_t b) {
+    while (b != 0) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// the pseudorandom function for Pollard's rho: y^2 + c (mod n)
+static inline uint64_t i_rho_f(const mont_t* M, uint64_t y, uint64_t c) {
+    uint64_t t = mont_mul(M, y, y) + c;
+    return t >= M->m ? t - M->m : t;
+}
 
-	for (i = 2; i * i <= n; i += 2) {
-		if (n % i == 0) {
-			while (n % i == 0) n /= i;
-			tot -= tot / i;
-		}
+// Return a non-trivial factor of the odd composite 'n', using Pollard's rho (with Brent's
+//   cycle finding, and batching the gcd's)
+// NOTE: the iteration is done in Montgomery form, which is just a different pseudorandom
+//   function, and doesn't change the gcd's (since 2^64 is coprime to 'n')
+static uint64_t i_rho(uint64_t n) {
+    mont_t M = mont_init(n);
+
+    // the number of steps between each gcd
+    const uint64_t m = 128;
+
+    uint64_t c;
+    for (c = 1; ; ++c) {
+        uint64_t x = 0, y = 2, ys = 2, q = mont_to(&M, 1), g = 1, r = 1, k, i;
+
+        do {
+            x = y;
+            for (i = 0; i < r; ++i) y = i_rho_f(&M, y, c);
+            for (k = 0; k < r && g == 1; k += m) {
+                ys = y;
+                for (i = 0; i < m && i < r - k; ++i) {
+                    y = i_rho_f(&M, y, c);
+                    q = mont_mul(&M, q, x > y ? x - y : y - x);
+                }
+                g = i_gcd(q, n);
+            }
+            r *= 2;
+        } while (g == 1);
 
-        // special case for first even number
-        if (i == 2) i = 1;
+        // the batch overshot, so go back and step one at a time
+        if (g == n) {
+            do {
+                ys = i_rho_f(&M, ys, c);
+                g = i_gcd(x > ys ? x - ys : ys - x, n);
+            } while (g == 1);
+        }
 
-	}
- 
-	if (n > 1) tot -= tot / n;
-	return tot;
+        // otherwise, the cycle had no factor, so try another 'c'
+        if (g != n) return g;
+    }
 }
 
+// add the unique prime factors of 'n' (which has none below I_TRIAL_MAX) to 'facts'
+static void i_factor_rho(uint64_t n, int64_t** facts, int64_t* nfacs) {
+    if (n == 1) return;
+
+    if (ntt_isprime(n)) {
+        int64_t i;
+        for (i = 0; i < *nfacs; ++i) {
+            if ((uint64_t)(*facts)[i] == n) return;
+        }
+        (*nfacs)++;
+        *facts = realloc(*facts, *nfacs * sizeof(**facts));
+        (*facts)[*nfacs - 1] = n;
+    } else {
+        uint64_t d = i_rho(n);
+        i_factor_rho(d, facts, nfacs);
+        i_factor_rho(n / d, facts, nfacs);
+    }
+}
 
 // Factor(n), yielding only unique prime factors
 int64_t ntt_factor_uup(int64_t n, int64_t** facts) {
@@ -191,53 +324,86 @@ int64_t ntt_factor_uup(int64_t n, int64_t** facts) {
         (*facts)[nfacs - 1] = (_x); \
     }
 
-    int64_t oN = n;
-
-    if (n % 2 == 0) ADD_FAC(2);
-    if (n % 3 == 0) ADD_FAC(3);
-
-    // max to check
-    int64_t mxN = n / 2;
-    //int64_t mxN = (int64_t)floor(sqrt(n));
-
-    int64_t i = 5;
-    while (i <= mxN) {
-
-        if (n % i == 0 && ntt_isprime(i)) {
+    // trial divide out the small factors (composite 'i' never divide, since their factors
+    //   were already taken out)
+    int64_t i;
+    for (i = 2; i < I_TRIAL_MAX && i * i <= n; i += (i == 2 ? 1 : 2)) {
+        if (n % i == 0) {
             ADD_FAC(i);
             do {
                 n /= i;
             } while (n % i == 0);
         }
-
-        if (n % (i + 2) == 0 && ntt_isprime(i + 2)) {
-            ADD_FAC(i + 2);
-            do {
-                n /= i + 2;
-            } while (n % (i + 2) == 0);
-        }
-
-        i += 6;
     }
 
-    // add remaining factor
-    if (n != 1) ADD_FAC(n);
-
     #undef ADD_FAC
+
+    // the rest are large, so use Pollard's rho
+    if (n > 1) i_factor_rho(n, facts, &nfacs);
+
     return nfacs;
 }
 
 
+// the built-in table of NTT primes (see './configure'), from largest to smallest
+static const struct {
+    uint64_t p, g;
+} i_prime_table[] = {
+#define I_PRIME_ENTRY(P, G) { P, G },
+    NTT_PRIME_TABLE(I_PRIME_ENTRY)
+#undef I_PRIME_ENTRY
+};
+
+#define I_PRIME_TABLE_LEN ((int64_t)(sizeof(i_prime_table) / sizeof(*i_prime_table)))
+
+// Return the largest prime p < 2^bits with p = 1 (mod N) from the built-in table
+int64_t ntt_prime_lookup(int64_t N, int bits, int skip, int64_t* g) {
+    int64_t i;
+    for (i = 0; i < I_PRIME_TABLE_LEN; ++i) {
+        uint64_t p = i_prime_table[i].p;
+        if (bits < 64 && p >= (1ULL << bits)) continue;
+        if ((p - 1) % N != 0) continue;
+        if (skip-- > 0) continue;
+
+        if (g != NULL) *g = i_prime_table[i].g;
+        return p;
+    }
+    return 0;
+}
+
 // Return the first primitive root of unity (mod n), or 0 if none exists
 int64_t ntt_prim_root_unity(int64_t n) {
 
-    // totient(p)
-    int64_t tot = ntt_tot(n);
+    // the primes in the built-in table already have theirs (binary search, since it's sorted)
+    int64_t lo = 0, hi = I_PRIME_TABLE_LEN;
+    while (lo < hi) {
+        int64_t mid = (lo + hi) / 2;
+        if (i_prime_table[mid].p > (uint64_t)n) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < I_PRIME_TABLE_LEN && i_prime_table[lo].p == (uint64_t)n) return i_prime_table[lo].g;
 
-    // totient factors
+    // totient(p), and its factors
+    int64_t tot;
     int64_t* tot_facts = NULL;
-    int64_t tot_n_facts = ntt_factor_uup(tot, &tot_facts);
-    
+    int64_t tot_n_facts;
+
+    if (ntt_isprime(n)) {
+        // phi(p) = p - 1 = 2^s * k, where 2^s is (at least) the transform size, so only the
+        //   (much smaller) 'k' needs factoring
+        tot = n - 1;
+        int64_t k = tot;
+        while (k > 1 && k % 2 == 0) k /= 2;
+        tot_n_facts = ntt_factor_uup(k, &tot_facts);
+        if (k != tot) {
+            tot_facts = realloc(tot_facts, ++tot_n_facts * sizeof(*tot_facts));
+            tot_facts[tot_n_facts - 1] = 2;
+        }
+    } else {
+        tot = ntt_tot(n);
+        tot_n_facts = ntt_factor_uup(tot, &tot_facts);
+    }
+
     // keep testing out tries
     int64_t a = 2;
     while (a <= n) {
@@ -246,7 +412,6 @@ int64_t ntt_prim_root_unity(int64_t n) {
         for (i = 0; i < tot_n_facts; ++i) {
             // calculate: a^(phi(n)/p_i) (mod p)
             int64_t r = ntt_modpow(a, tot / tot_facts[i], n);
-            //printf("%i ^ %i = %i (mod %i)\n", a, tot / tot_facts[i], r, n);
             if (r == 1) {
                 eq1 = 1;
                 break;
@@ -265,8 +430,15 @@ int64_t ntt_prim_root_unity(int64_t n) {
     return 0;
 }
 
-// Calculate n'th root of unity mod p
+// Calculate a primitive n'th root of unity mod p
 int64_t ntt_nth_root_unity(int64_t n, int64_t p) {
+    if (ntt_isprime(p)) {
+        // all of them are powers of the primitive root
+        if ((p - 1) % n != 0) return 0;
+        return ntt_modpow(ntt_prim_root_unity(p), (p - 1) / n, p);
+    }
+
+    // otherwise, search for one (which may not be primitive)
     int64_t i;
     for (i = 2; i < n; ++i) {
         if (ntt_modpow(i, n, p) == 1) {
@@ -277,3 +449,24 @@ int64_t ntt_nth_root_unity(int64_t n, int64_t p) {
     return 0;
 
 }
+
+// Return the smallest number >= n of the form 2^a * 3^b * 5^c
+int64_t ntt_smooth_size(int64_t n) {
+    if (n <= 1) return 1;
+
+    // the best found so far (which is always possible, as a power of 2)
+    int64_t best = 1;
+    while (best < n) best *= 2;
+
+    // try every power of 5 and 3, then round up with a power of 2
+    int64_t p5, p3;
+    for (p5 = 1; p5 < best; p5 *= 5) {
+        for (p3 = p5; p3 < best; p3 *= 3) {
+            int64_t x = p3;
+            while (x < n) x *= 2;
+            if (x < best) best = x;
+        }
+    }
+
+    return best;
+}
@@ -0,0 +1,370 @@
+/* bfly32_plan.c - butterfly-based NTT code with 32 bit coefficients (for p < 2^31)
+ *
+ * This is the same algorithm as 'bfly_plan.c' (for N a power of 2), but everything is
+ *   stored as 'uint32_t', which halves the memory traffic of large transforms
+ *
+ */
+
+#include "ntt.h"
+#include "ntt-impl.h"
+
+
+// shuffle a sequence with bit-reversal index mapping
+static void shuffle_bitrev32(uint32_t* inp, int64_t N) {
+    int64_t i, j = 0;
+    for (i = 1; i < N; ++i) {
+        int64_t b = (N >> 1);
+        while (j >= b) {
+            j -= b;
+            b >>= 1;
+        }
+        j += b;
+        if (j > i) {
+            uint32_t t = inp[i];
+            inp[i] = inp[j];
+            inp[j] = t;
+        }
+    }
+}
+
+// initialize 32 bit butterfly-based plan
+void ntt_plan_bfly32_init(ntt_plan_bfly32_t* plan, int64_t N, uint32_t p) {
+    // only the radix-2/4 stages are here
+    assert(N >= 1 && (N & (N - 1)) == 0);
+
+    // take 'p' from the built-in table, as the largest prime that lazy reduction works for
+    //   (or, if there's none for this N, search for the smallest one)
+    if (p == 0) p = ntt_prime_lookup(N, 30, 0, NULL);
+    if (p == 0) {
+        int64_t pp = N + 1;
+        while (!ntt_isprime(pp)) pp += N;
+        assert(pp < (1LL << 31));
+        p = pp;
+    }
+    assert(p < (1U << 31) && (p - 1) % N == 0);
+
+    // save NTT data
+    plan->N = N;
+    plan->p = p;
+    plan->N_inv = ntt_modinv(N, p);
+    plan->N_inv_shoup = ntt_i_shoup32(plan->N_inv, p);
+
+    // pick the best kernels for this CPU
+    plan->isa = ntt_isa_detect();
+    plan->radix = 4;
+    plan->nthreads = 1;
+
+    // allocate twiddle tables (from a single aligned arena)
+    size_t tsz = sizeof(*plan->W) * N;
+    ntt_i_free(plan->mem);
+    plan->mem = ntt_i_alloc(4 * ntt_i_aligned(tsz));
+    char* cur = plan->mem;
+    plan->W = ntt_i_carve(&cur, tsz);
+    plan->IW = ntt_i_carve(&cur, tsz);
+    plan->W_shoup = ntt_i_carve(&cur, tsz);
+    plan->IW_shoup = ntt_i_carve(&cur, tsz);
+
+    // calculate roots of unity, using NT
+    int64_t w = ntt_modpow(ntt_prim_root_unity(p), (p - 1) / N, p);
+    int64_t w_inv = ntt_modinv(w, p);
+
+    int64_t Wi = 1, Wi_inv = 1;
+
+    // caculate twiddle factors w^i (mod p) for the last stage
+    int64_t i, m2 = N / 2;
+    for (i = 0; i < m2; ++i) {
+        plan->W[m2 + i] = Wi;
+        plan->IW[m2 + i] = Wi_inv;
+        Wi = ntt_modmul(Wi, w, p);
+        Wi_inv = ntt_modmul(Wi_inv, w_inv, p);
+    }
+
+    // every previous stage uses every other twiddle of the one after it
+    for (m2 = N / 4; m2 >= 1; m2 /= 2) {
+        for (i = 0; i < m2; ++i) {
+            plan->W[m2 + i] = plan->W[2 * m2 + 2 * i];
+            plan->IW[m2 + i] = plan->IW[2 * m2 + 2 * i];
+        }
+    }
+    plan->W[0] = plan->IW[0] = 1;
+
+    for (i = 0; i < N; ++i) {
+        plan->W_shoup[i] = ntt_i_shoup32(plan->W[i], p);
+        plan->IW_shoup[i] = ntt_i_shoup32(plan->IW[i], p);
+    }
+}
+
+// free the plan's tables
+void ntt_plan_bfly32_free(ntt_plan_bfly32_t* plan) {
+    ntt_i_free(plan->mem);
+    *plan = NTT_PLAN_BFLY32_EMPTY;
+}
+
+// the number of threads a single transform of this plan is split across
+static int bfly32_threads(ntt_plan_bfly32_t* plan) {
+    return plan->N >= NTT_BFLY_MT_MIN_N && plan->nthreads > 1 ? plan->nthreads : 1;
+}
+
+// whether lazy reduction can be used (4p has to fit in 32 bits)
+static bool bfly32_lazy(ntt_plan_bfly32_t* plan) {
+    return plan->lazy && plan->p < (1U << 30);
+}
+
+// DIT (Cooley-Tukey) butterfly: (U, V) -> (U + wV, U - wV)
+// If 'lazy', values are kept in [0, 4p) (which requires p < 2^30), otherwise [0, p)
+static inline void dit_bfly32(uint32_t* U, uint32_t* V, uint32_t w, uint32_t w_shoup, uint32_t p, bool lazy) {
+    uint32_t u = *U, v;
+    if (lazy) {
+        if (u >= 2 * p) u -= 2 * p;
+        v = ntt_i_mulshoup32_lazy(*V, w, w_shoup, p);
+        *U = u + v;
+        *V = u + 2 * p - v;
+    } else {
+        v = ntt_i_mulshoup32(*V, w, w_shoup, p);
+        *U = u + v >= p ? u + v - p : u + v;
+        *V = u >= v ? u - v : u + p - v;
+    }
+}
+
+// DIF (Gentleman-Sande) butterfly: (U, V) -> (U + V, w(U - V))
+// If 'lazy', values are kept in [0, 2p), otherwise [0, p)
+static inline void dif_bfly32(uint32_t* U, uint32_t* V, uint32_t w, uint32_t w_shoup, uint32_t p, bool lazy) {
+    uint32_t u = *U, v = *V;
+    if (lazy) {
+        *U = u + v >= 2 * p ? u + v - 2 * p : u + v;
+        *V = ntt_i_mulshoup32_lazy(u + 2 * p - v, w, w_shoup, p);
+    } else {
+        *U = u + v >= p ? u + v - p : u + v;
+        *V = ntt_i_mulshoup32(u + p - v, w, w_shoup, p);
+    }
+}
+
+// run a single DIT stage (if 'radix' is 2), or pass (if 'radix' is 4, fusing the stages
+//   'm2' and '2*m2'), on the butterflies i in [i0, i1) of each block (see 'dit_range' in
+//   'bfly_plan.c')
+static void dit32_range(ntt_plan_bfly32_t* plan, uint32_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, int radix, uint32_t* W, uint32_t* W_shoup, bool lazy) {
+    uint32_t p = plan->p;
+    int vw = ntt_i_isa_width32(plan->isa);
+    int64_t i, k;
+
+    if (vw > 0 && m2 >= vw) {
+#ifdef NTT_I_X86
+        if (radix == 4) {
+            if (plan->isa >= NTT_ISA_AVX512) ntt_i_dit4_stage32_avx512(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+            else ntt_i_dit4_stage32_avx2(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+        } else {
+            if (plan->isa >= NTT_ISA_AVX512) ntt_i_dit_stage32_avx512(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+            else ntt_i_dit_stage32_avx2(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+        }
+#endif
+    } else if (radix == 4) {
+        for (k = 0; k < N; k += 4 * m2) {
+            for (i = i0; i < i1; ++i) {
+                uint32_t a0 = x[k + i], a1 = x[k + i + m2], a2 = x[k + i + 2 * m2], a3 = x[k + i + 3 * m2];
+                dit_bfly32(&a0, &a1, W[m2 + i], W_shoup[m2 + i], p, lazy);
+                dit_bfly32(&a2, &a3, W[m2 + i], W_shoup[m2 + i], p, lazy);
+                dit_bfly32(&a0, &a2, W[2 * m2 + i], W_shoup[2 * m2 + i], p, lazy);
+                dit_bfly32(&a1, &a3, W[3 * m2 + i], W_shoup[3 * m2 + i], p, lazy);
+                x[k + i] = a0; x[k + i + m2] = a1; x[k + i + 2 * m2] = a2; x[k + i + 3 * m2] = a3;
+            }
+        }
+    } else {
+        for (k = 0; k < N; k += 2 * m2) {
+            for (i = i0; i < i1; ++i) {
+                dit_bfly32(&x[k + i], &x[k + i + m2], W[m2 + i], W_shoup[m2 + i], p, lazy);
+            }
+        }
+    }
+}
+
+// run a single DIF stage or pass, with the same conventions as 'dit32_range'
+static void dif32_range(ntt_plan_bfly32_t* plan, uint32_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, int radix, uint32_t* W, uint32_t* W_shoup, bool lazy) {
+    uint32_t p = plan->p;
+    int vw = ntt_i_isa_width32(plan->isa);
+    int64_t i, k;
+
+    if (vw > 0 && m2 >= vw) {
+#ifdef NTT_I_X86
+        if (radix == 4) {
+            if (plan->isa >= NTT_ISA_AVX512) ntt_i_dif4_stage32_avx512(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+            else ntt_i_dif4_stage32_avx2(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+        } else {
+            if (plan->isa >= NTT_ISA_AVX512) ntt_i_dif_stage32_avx512(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+            else ntt_i_dif_stage32_avx2(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+        }
+#endif
+    } else if (radix == 4) {
+        for (k = 0; k < N; k += 4 * m2) {
+            for (i = i0; i < i1; ++i) {
+                uint32_t a0 = x[k + i], a1 = x[k + i + m2], a2 = x[k + i + 2 * m2], a3 = x[k + i + 3 * m2];
+                dif_bfly32(&a0, &a2, W[2 * m2 + i], W_shoup[2 * m2 + i], p, lazy);
+                dif_bfly32(&a1, &a3, W[3 * m2 + i], W_shoup[3 * m2 + i], p, lazy);
+                dif_bfly32(&a0, &a1, W[m2 + i], W_shoup[m2 + i], p, lazy);
+                dif_bfly32(&a2, &a3, W[m2 + i], W_shoup[m2 + i], p, lazy);
+                x[k + i] = a0; x[k + i + m2] = a1; x[k + i + 2 * m2] = a2; x[k + i + 3 * m2] = a3;
+            }
+        }
+    } else {
+        for (k = 0; k < N; k += 2 * m2) {
+            for (i = i0; i < i1; ++i) {
+                dif_bfly32(&x[k + i], &x[k + i + m2], W[m2 + i], W_shoup[m2 + i], p, lazy);
+            }
+        }
+    }
+}
+
+// run a single DIT or DIF (if 'dif') stage/pass over all of 'x', split across the plan's
+//   threads (see 'bfly_pass' in 'bfly_plan.c')
+static void bfly32_pass(ntt_plan_bfly32_t* plan, uint32_t* x, int64_t m2, int radix, uint32_t* W, uint32_t* W_shoup, bool lazy, bool dif) {
+    int64_t N = plan->N;
+    int nt = bfly32_threads(plan);
+
+    if (nt == 1) {
+        if (dif) dif32_range(plan, x, N, m2, 0, m2, radix, W, W_shoup, lazy);
+        else dit32_range(plan, x, N, m2, 0, m2, radix, W, W_shoup, lazy);
+        return;
+    }
+
+    int64_t bs = radix * m2, nb = N / bs;
+
+    int t;
+    if (nb >= nt) {
+        #pragma omp parallel for num_threads(nt)
+        for (t = 0; t < nt; ++t) {
+            int64_t b0 = nb * t / nt, b1 = nb * (t + 1) / nt;
+            if (dif) dif32_range(plan, x + b0 * bs, (b1 - b0) * bs, m2, 0, m2, radix, W, W_shoup, lazy);
+            else dit32_range(plan, x + b0 * bs, (b1 - b0) * bs, m2, 0, m2, radix, W, W_shoup, lazy);
+        }
+    } else {
+        // (on multiples of 16, so the SIMD kernels get whole vectors)
+        #pragma omp parallel for num_threads(nt)
+        for (t = 0; t < nt; ++t) {
+            int64_t i0 = (m2 * t / nt) & ~15LL;
+            int64_t i1 = t == nt - 1 ? m2 : (m2 * (t + 1) / nt) & ~15LL;
+            if (dif) dif32_range(plan, x, N, m2, i0, i1, radix, W, W_shoup, lazy);
+            else dit32_range(plan, x, N, m2, i0, i1, radix, W, W_shoup, lazy);
+        }
+    }
+}
+
+// run all the DIT stages in place on 'x' (which is in bit reversed order, and reduced
+//   into [0, p)), leaving it in [0, 4p) if 'lazy'
+static void bfly32_dit(ntt_plan_bfly32_t* plan, uint32_t* x, bool inv, bool lazy) {
+    int64_t N = plan->N, m2 = 1;
+    uint32_t* W = inv ? plan->IW : plan->W;
+    uint32_t* W_shoup = inv ? plan->IW_shoup : plan->W_shoup;
+
+    if (plan->radix == 4) {
+        // finish off an odd number of stages with a single radix-2 stage
+        int64_t lgN = 0;
+        while ((1LL << lgN) < N) lgN++;
+        if (lgN % 2 == 1) {
+            bfly32_pass(plan, x, m2, 2, W, W_shoup, lazy, false);
+            m2 *= 2;
+        }
+        for (; m2 < N; m2 *= 4) {
+            bfly32_pass(plan, x, m2, 4, W, W_shoup, lazy, false);
+        }
+    } else {
+        for (; m2 < N; m2 *= 2) {
+            bfly32_pass(plan, x, m2, 2, W, W_shoup, lazy, false);
+        }
+    }
+}
+
+// run all the DIF stages in place on 'x' (which is in natural order, and reduced
+//   into [0, p)), leaving the result in bit reversed order (in [0, 2p) if 'lazy')
+static void bfly32_dif(ntt_plan_bfly32_t* plan, uint32_t* x, bool inv, bool lazy) {
+    int64_t N = plan->N, m2 = N / 2;
+    uint32_t* W = inv ? plan->IW : plan->W;
+    uint32_t* W_shoup = inv ? plan->IW_shoup : plan->W_shoup;
+
+    if (plan->radix == 4) {
+        for (; m2 >= 2; m2 /= 4) {
+            bfly32_pass(plan, x, m2 / 2, 4, W, W_shoup, lazy, true);
+        }
+        if (m2 == 1) {
+            bfly32_pass(plan, x, m2, 2, W, W_shoup, lazy, true);
+        }
+    } else {
+        for (; m2 >= 1; m2 /= 2) {
+            bfly32_pass(plan, x, m2, 2, W, W_shoup, lazy, true);
+        }
+    }
+}
+
+// copy 'inp' to 'out', reducing every element into [0, p)
+static void copy_reduce32(ntt_plan_bfly32_t* plan, uint32_t* out, uint32_t* inp) {
+    uint32_t p = plan->p;
+    int nt = bfly32_threads(plan);
+
+    int64_t i;
+    #pragma omp parallel for num_threads(nt) if(nt > 1)
+    for (i = 0; i < plan->N; ++i) {
+        out[i] = inp[i] >= p ? inp[i] % p : inp[i];
+    }
+}
+
+// reduce lazy values in 'x' (which are in [0, 4p)) into [0, p)
+static void normalize32(ntt_plan_bfly32_t* plan, uint32_t* x) {
+    uint32_t p = plan->p;
+    int nt = bfly32_threads(plan);
+
+    int64_t i;
+    #pragma omp parallel for num_threads(nt) if(nt > 1)
+    for (i = 0; i < plan->N; ++i) {
+        if (x[i] >= 2 * p) x[i] -= 2 * p;
+        if (x[i] >= p) x[i] -= p;
+    }
+}
+
+// multiply by the corrective factor N^-1 (which also normalizes lazy values)
+static void scale_N_inv32(ntt_plan_bfly32_t* plan, uint32_t* x) {
+    int nt = bfly32_threads(plan);
+
+    int64_t i;
+    #pragma omp parallel for num_threads(nt) if(nt > 1)
+    for (i = 0; i < plan->N; ++i) {
+        x[i] = ntt_i_mulshoup32(x[i], plan->N_inv, plan->N_inv_shoup, plan->p);
+    }
+}
+
+// Do forward NTT:
+// out = NTT(inp)
+void ntt_plan_bfly32_NTT(ntt_plan_bfly32_t* plan, uint32_t* inp, uint32_t* out) {
+    copy_reduce32(plan, out, inp);
+    shuffle_bitrev32(out, plan->N);
+
+    bool lazy = bfly32_lazy(plan);
+    bfly32_dit(plan, out, false, lazy);
+    if (lazy) normalize32(plan, out);
+}
+
+// Do inverse NTT (INTT):
+// out = INTT(inp)
+void ntt_plan_bfly32_INTT(ntt_plan_bfly32_t* plan, uint32_t* inp, uint32_t* out) {
+    copy_reduce32(plan, out, inp);
+    shuffle_bitrev32(out, plan->N);
+
+    bfly32_dit(plan, out, true, bfly32_lazy(plan));
+    scale_N_inv32(plan, out);
+}
+
+// Do forward NTT, leaving the result in bit reversed order:
+// out = bitrev(NTT(inp))
+void ntt_plan_bfly32_NTT_bitrev(ntt_plan_bfly32_t* plan, uint32_t* inp, uint32_t* out) {
+    copy_reduce32(plan, out, inp);
+
+    bool lazy = bfly32_lazy(plan);
+    bfly32_dif(plan, out, false, lazy);
+    if (lazy) normalize32(plan, out);
+}
+
+// Do inverse NTT (INTT), taking the input in bit reversed order:
+// out = INTT(bitrev(inp))
+void ntt_plan_bfly32_INTT_bitrev(ntt_plan_bfly32_t* plan, uint32_t* inp, uint32_t* out) {
+    copy_reduce32(plan, out, inp);
+
+    bfly32_dit(plan, out, true, bfly32_lazy(plan));
+    scale_N_inv32(plan, out);
+}
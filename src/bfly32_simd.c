@@ -0,0 +1,110 @@
+/* bfly32_simd.c - vectorized butterfly kernels for 32 bit coefficients (AVX2, AVX-512)
+ *
+ * These use the same kernel loops as 'bfly_simd.c' (from 'bfly_simd_kern.h'), but each
+ *   vector holds twice as many coefficients. The Shoup quotient is the high half of a
+ *   32x32->64 bit multiply, which is done separately for the even and odd lanes
+ *
+ */
+
+#include "ntt.h"
+#include "ntt-impl.h"
+
+
+// Return the number of 32 bit lanes the kernels for 'isa' process at once, or
+//   0 if they can't be used
+int ntt_i_isa_width32(ntt_isa_t isa) {
+#ifdef NTT_I_X86
+    if (isa >= NTT_ISA_AVX512) return 16;
+    if (isa >= NTT_ISA_AVX2) return 8;
+#endif
+    return 0;
+}
+
+
+#ifdef NTT_I_X86
+
+#include <immintrin.h>
+
+
+/* AVX2 */
+
+// the high 32 bits of the lane-wise 32x32->64 bit products
+__attribute__((target("avx2"))) static inline __m256i avx2_mulhi32(__m256i a, __m256i b) {
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(a, b), 32);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+    return _mm256_blend_epi32(even, odd, 0xAA);
+}
+
+// x*w (mod p) in [0, 2p), where 'wq' is the 32 bit Shoup quotient
+__attribute__((target("avx2"))) static inline __m256i avx2_mulshoup32_lazy(__m256i x, __m256i w, __m256i wq, __m256i p) {
+    __m256i q = avx2_mulhi32(x, wq);
+    return _mm256_sub_epi32(_mm256_mullo_epi32(x, w), _mm256_mullo_epi32(q, p));
+}
+
+#define KERN(name) name##32_avx2
+#define ATTR __attribute__((target("avx2")))
+#define VW 8
+#define VEC __m256i
+#define V_LOAD(ptr) _mm256_loadu_si256((const __m256i*)(ptr))
+#define V_STORE(ptr, v) _mm256_storeu_si256((__m256i*)(ptr), (v))
+#define V_SET1(x) _mm256_set1_epi32(x)
+#define V_ADD(a, b) _mm256_add_epi32((a), (b))
+#define V_SUB(a, b) _mm256_sub_epi32((a), (b))
+// (if x < p, then x - p wraps around to be larger than x)
+#define V_CSUB(x, p) _mm256_min_epu32((x), _mm256_sub_epi32((x), (p)))
+#define V_QUOT(ptr) V_LOAD(ptr)
+#define V_MULSHOUP(x, w, wq, p) avx2_mulshoup32_lazy((x), (w), (wq), (p))
+#define T_X uint32_t
+#define T_W uint32_t
+#define T_WQ uint32_t
+
+#include "bfly_simd_kern.h"
+
+#undef KERN
+#undef ATTR
+#undef VW
+#undef VEC
+#undef V_LOAD
+#undef V_STORE
+#undef V_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_CSUB
+#undef V_QUOT
+#undef V_MULSHOUP
+
+
+/* AVX-512 */
+
+// the high 32 bits of the lane-wise 32x32->64 bit products
+__attribute__((target("avx512f"))) static inline __m512i avx512_mulhi32(__m512i a, __m512i b) {
+    __m512i even = _mm512_srli_epi64(_mm512_mul_epu32(a, b), 32);
+    __m512i odd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), _mm512_srli_epi64(b, 32));
+    return _mm512_mask_blend_epi32(0xAAAA, even, odd);
+}
+
+// x*w (mod p) in [0, 2p), where 'wq' is the 32 bit Shoup quotient
+__attribute__((target("avx512f"))) static inline __m512i avx512_mulshoup32_lazy(__m512i x, __m512i w, __m512i wq, __m512i p) {
+    __m512i q = avx512_mulhi32(x, wq);
+    return _mm512_sub_epi32(_mm512_mullo_epi32(x, w), _mm512_mullo_epi32(q, p));
+}
+
+#define KERN(name) name##32_avx512
+#define ATTR __attribute__((target("avx512f")))
+#define VW 16
+#define VEC __m512i
+#define V_LOAD(ptr) _mm512_loadu_si512((const void*)(ptr))
+#define V_STORE(ptr, v) _mm512_storeu_si512((void*)(ptr), (v))
+#define V_SET1(x) _mm512_set1_epi32(x)
+#define V_ADD(a, b) _mm512_add_epi32((a), (b))
+#define V_SUB(a, b) _mm512_sub_epi32((a), (b))
+#define V_CSUB(x, p) _mm512_min_epu32((x), _mm512_sub_epi32((x), (p)))
+#define V_QUOT(ptr) V_LOAD(ptr)
+#define V_MULSHOUP(x, w, wq, p) avx512_mulshoup32_lazy((x), (w), (wq), (p))
+#define T_X uint32_t
+#define T_W uint32_t
+#define T_WQ uint32_t
+
+#include "bfly_simd_kern.h"
+
+#endif /* NTT_I_X86 */
@@ -0,0 +1,60 @@
+/* bfly_fixed.c - kernels specialized for fixed primes
+ *
+ * './configure --ntt-primes' writes the list of primes (and their primitive roots) to
+ *   'ntt-config.h' as 'NTT_FIXED_PRIMES', and this file instantiates the kernels once for
+ *   each of them, with 'p' as a compile time constant. Then, the '%' in the pointwise
+ *   products compiles to a multiply and shift, instead of a division
+ *
+ * NOTE: the butterflies themselves aren't specialized, since the Shoup multiplies don't
+ *   divide by 'p' anyway, and they measured no faster with it baked in
+ *
+ */
+
+#include "ntt.h"
+#include "ntt-impl.h"
+
+
+// the pointwise product for a constant 'p', where the division is turned into a multiply
+//   by the compiler (for p < 2^32, the product fits in 64 bits)
+static inline void fixed_mulmod(int64_t* out, const int64_t* a, const int64_t* b, int64_t n, uint64_t p) {
+    int64_t i;
+    if (p < (1ULL << 32)) {
+        for (i = 0; i < n; ++i) out[i] = ((uint64_t)a[i] * (uint64_t)b[i]) % p;
+    } else {
+        for (i = 0; i < n; ++i) out[i] = ntt_modmul(a[i], b[i], p);
+    }
+}
+
+#ifdef NTT_FIXED_PRIMES
+
+// define the kernels for the prime at 'idx'
+#define NTT_I_FIXED_KERNS(idx, P, G) \
+static void mulmod_##idx(int64_t* out, const int64_t* a, const int64_t* b, int64_t n) { \
+    fixed_mulmod(out, a, b, n, P); \
+}
+
+NTT_FIXED_PRIMES(NTT_I_FIXED_KERNS)
+
+// the table entry for the prime at 'idx'
+#define NTT_I_FIXED_ENTRY(idx, P, G) \
+    { .p = P, .g = G, .mulmod = mulmod_##idx },
+
+#else
+
+#define NTT_FIXED_PRIMES(X)
+
+#endif
+
+const ntt_i_fixed_t ntt_i_fixed[] = {
+    NTT_FIXED_PRIMES(NTT_I_FIXED_ENTRY)
+    { .p = 0 }
+};
+
+// Return the index of 'p' in 'ntt_i_fixed', or -1 if there are no kernels for it
+int ntt_i_fixed_find(uint64_t p) {
+    int i;
+    for (i = 0; ntt_i_fixed[i].p != 0; ++i) {
+        if (ntt_i_fixed[i].p == p) return i;
+    }
+    return -1;
+}
@@ -1,6 +1,7 @@
 /* bfly_plan.c - butterfly-based NTT code, which is faster than GEMM-based */
 
 #include "ntt.h"
+#include "ntt-impl.h"
 
 
 // Get the reversed bits of 'x'
@@ -36,138 +37,895 @@ static void shuffle_bitrev(int64_t* inp, int64_t N) {
 
 }
 
+// the radix of the next stage, for the remaining (odd) factor 'M' = 3^b * 5^c of N
+static int mixed_radix(int64_t M) {
+    return M % 5 == 0 ? 5 : 3;
+}
+
+// fill 'rs' with the radices of the radix-3/5 stages (in DIF order, so the first one is
+//   on the whole array), returning how many there are
+static int mixed_radices(ntt_plan_bfly_t* plan, int* rs) {
+    int n_rs = 0;
+    int64_t L;
+    for (L = plan->N; L > plan->N_pow2; L /= rs[n_rs++]) {
+        rs[n_rs] = mixed_radix(L / plan->N_pow2);
+    }
+    return n_rs;
+}
+
 // initialize butterfly-based plan
 void ntt_plan_bfly_init(ntt_plan_bfly_t* plan, int64_t N, int64_t p) {
+    // the radix-3/5 stages treat any odd factor that isn't a 5 as a 3, so other lengths would
+    //   silently give the wrong transform
+    assert(N >= 1 && ntt_smooth_size(N) == N);
 
-    // search for appropriate 'p'
+    // take 'p' from the built-in table, as the largest prime the SIMD kernels can use (or,
+    //   if there's none for this N, search for the smallest one)
+    if (p == 0) p = ntt_prime_lookup(N, 30, 0, NULL);
     if (p == 0) {
         p = N + 1;
         while (!ntt_isprime(p)) p += N;
     }
+    assert((p - 1) % N == 0);
 
     // save NTT data
     plan->N = N;
     plan->p = p;
     plan->N_inv = ntt_modinv(N, p);
 
-    // allocate twiddle tables
-    plan->W = realloc(plan->W, sizeof(*plan->W) * N);
-    plan->IW = realloc(plan->IW, sizeof(*plan->IW) * N);
-
-    // bit reversed
-    plan->W_br = realloc(plan->W_br, sizeof(*plan->W_br) * N);
+    // pick the best kernels for this CPU
+    plan->isa = ntt_isa_detect();
+    plan->radix = 4;
+    plan->nthreads = 1;
+
+    // split off the power of 2 part of N, which uses the radix-2/4 kernels
+    int64_t n2 = N & -N;
+    plan->N_pow2 = n2;
+
+    // the interleaved batch tables are only for small powers of 2, and the digit reversal
+    //   permutation (and the scratch buffer for it) is only for the mixed radix sizes
+    bool batch = N <= NTT_BFLY_BATCH_MAX_N && n2 == N;
+    size_t tsz = sizeof(*plan->W) * N, bsz = batch ? sizeof(*plan->W_batch) * N * NTT_BFLY_BATCH_L : 0;
+    size_t psz = n2 < N ? sizeof(*plan->perm) * N : 0;
+
+    // allocate all the tables from a single (aligned) arena
+    ntt_i_free(plan->mem);
+    plan->mem = ntt_i_alloc(4 * ntt_i_aligned(tsz) + 4 * ntt_i_aligned(bsz) + 2 * ntt_i_aligned(psz));
+    char* cur = plan->mem;
+    plan->W = ntt_i_carve(&cur, tsz);
+    plan->IW = ntt_i_carve(&cur, tsz);
+    plan->W_shoup = ntt_i_carve(&cur, tsz);
+    plan->IW_shoup = ntt_i_carve(&cur, tsz);
+    plan->W_batch = batch ? ntt_i_carve(&cur, bsz) : NULL;
+    plan->IW_batch = batch ? ntt_i_carve(&cur, bsz) : NULL;
+    plan->W_batch_shoup = batch ? ntt_i_carve(&cur, bsz) : NULL;
+    plan->IW_batch_shoup = batch ? ntt_i_carve(&cur, bsz) : NULL;
+    plan->perm = n2 < N ? ntt_i_carve(&cur, psz) : NULL;
+    plan->tmp = n2 < N ? ntt_i_carve(&cur, psz) : NULL;
 
     int64_t k = (p - 1) / N;
 
+    // the primes from './configure --ntt-primes' already have their primitive roots computed
+    plan->fixed = ntt_i_fixed_find(p);
+
     // calculate a primitive root of unity and it's inverse
-    int64_t rt_p = ntt_prim_root_unity(p);
+    int64_t rt_p = plan->fixed >= 0 ? (int64_t)ntt_i_fixed[plan->fixed].g : ntt_prim_root_unity(p);
 
     // calculate roots of unity, using NT
     int64_t w = ntt_modpow(rt_p, k, p);
     int64_t w_inv = ntt_modinv(w, p);
 
+    // the power of 2 stages use the (N_pow2)th root of unity
+    int64_t w2 = ntt_modpow(w, N / n2, p), w2_inv = ntt_modinv(w2, p);
+
     int64_t Wi = 1, Wi_inv = 1;
 
-    // caculate twiddle factors w^i (mod p)
+    // caculate twiddle factors w^i (mod p) for the last stage (with Shoup multiplies, since
+    //   'w2' is a constant, which avoids a division per twiddle)
+    uint64_t w2_shoup = ntt_i_shoup(w2, p), w2_inv_shoup = ntt_i_shoup(w2_inv, p);
+    int64_t i, j, m2 = n2 / 2;
+    for (i = 0; i < m2; ++i) {
+        plan->W[m2 + i] = Wi;
+        plan->IW[m2 + i] = Wi_inv;
+        Wi = ntt_i_mulshoup(Wi, w2, w2_shoup, p);
+        Wi_inv = ntt_i_mulshoup(Wi_inv, w2_inv, w2_inv_shoup, p);
+    }
+
+    // every previous stage uses every other twiddle of the one after it
+    for (m2 = n2 / 4; m2 >= 1; m2 /= 2) {
+        for (i = 0; i < m2; ++i) {
+            plan->W[m2 + i] = plan->W[2 * m2 + 2 * i];
+            plan->IW[m2 + i] = plan->IW[2 * m2 + 2 * i];
+        }
+    }
+
+    // the radix-3/5 stages, on blocks of length L = r * m, use W[s * m + j] = w_L^(s * j)
+    int64_t L;
+    for (L = N; L > n2; L /= mixed_radix(L / n2)) {
+        int r = mixed_radix(L / n2), s;
+        int64_t m = L / r;
+        int64_t wL = ntt_modpow(w, N / L, p), wL_inv = ntt_modinv(wL, p);
+        int64_t wLs = 1, wLs_inv = 1;
+        for (s = 1; s < r; ++s) {
+            wLs = ntt_modmul(wLs, wL, p);
+            wLs_inv = ntt_modmul(wLs_inv, wL_inv, p);
+            Wi = Wi_inv = 1;
+            for (j = 0; j < m; ++j) {
+                plan->W[s * m + j] = Wi;
+                plan->IW[s * m + j] = Wi_inv;
+                Wi = ntt_modmul(Wi, wLs, p);
+                Wi_inv = ntt_modmul(Wi_inv, wLs_inv, p);
+            }
+        }
+    }
+
+    // and the constants for the radix-3/5 butterflies themselves
+    int64_t inv2 = ntt_modinv(2, p);
+    for (i = 0; i < 2; ++i) {
+        // the forward constants use 'w', and the inverse ones use 'w_inv'
+        int64_t wr = i == 0 ? w : w_inv;
+        int64_t* R3 = i == 0 ? plan->R3 : plan->IR3;
+        int64_t* R5 = i == 0 ? plan->R5 : plan->IR5;
+        if (N % 3 == 0) {
+            int64_t w3 = ntt_modpow(wr, N / 3, p), w3_2 = ntt_modmul(w3, w3, p);
+            R3[0] = p - inv2;
+            R3[1] = ntt_modmul((w3 - w3_2 + p) % p, inv2, p);
+        }
+        if (N % 5 == 0) {
+            int64_t w5[5], t;
+            w5[0] = 1;
+            for (t = 1; t < 5; ++t) w5[t] = ntt_modmul(w5[t - 1], ntt_modpow(wr, N / 5, p), p);
+            R5[0] = ntt_modmul((w5[1] + w5[4]) % p, inv2, p);
+            R5[1] = ntt_modmul((w5[2] + w5[3]) % p, inv2, p);
+            R5[2] = ntt_modmul((w5[1] - w5[4] + p) % p, inv2, p);
+            R5[3] = ntt_modmul((w5[2] - w5[3] + p) % p, inv2, p);
+        }
+    }
+
+    // the output order of the DIF stages, which is just bit reversal for a power of 2
+    if (n2 < N) {
+        // start with bit reversal for the innermost blocks
+        int64_t lg2 = 0;
+        while ((1LL << lg2) < n2) lg2++;
+        for (i = 0; i < n2; ++i) {
+            int64_t b, r = 0;
+            for (b = 0; b < lg2; ++b) r |= ((i >> b) & 1) << (lg2 - 1 - b);
+            plan->perm[i] = r;
+        }
+
+        // then, working outwards, each radix-r stage puts output 's' of the sub-block into the
+        //   's'th block of length m (so, the digits come out reversed)
+        int rs[64], n_rs = mixed_radices(plan, rs), t;
+        int64_t m = n2;
+        for (t = n_rs - 1; t >= 0; --t) {
+            int r = rs[t], s;
+            for (s = r - 1; s >= 0; --s) {
+                for (i = 0; i < m; ++i) {
+                    plan->perm[s * m + i] = s + r * plan->perm[i];
+                }
+            }
+            m *= r;
+        }
+    }
+    plan->W[0] = plan->IW[0] = 1;
+
+    // the Shoup quotients need a division each, so only compute them for the last power of 2
+    //   stage (and the radix-3/5 stages after it), and copy them down like the twiddles
+    for (i = n2 / 2; i < N; ++i) {
+        plan->W_shoup[i] = ntt_i_shoup(plan->W[i], p);
+        plan->IW_shoup[i] = ntt_i_shoup(plan->IW[i], p);
+    }
+    for (m2 = n2 / 4; m2 >= 1; m2 /= 2) {
+        for (i = 0; i < m2; ++i) {
+            plan->W_shoup[m2 + i] = plan->W_shoup[2 * m2 + 2 * i];
+            plan->IW_shoup[m2 + i] = plan->IW_shoup[2 * m2 + 2 * i];
+        }
+    }
+    plan->W_shoup[0] = plan->IW_shoup[0] = ntt_i_shoup(1, p);
+
+    plan->N_inv_shoup = ntt_i_shoup(plan->N_inv, p);
+
+    // expand the twiddle tables for the interleaved batches, with each twiddle repeated
+    //   once per lane (only for powers of 2)
+    if (batch) {
+        int64_t nl = NTT_BFLY_BATCH_L;
+        for (i = 0; i < N * nl; ++i) {
+            plan->W_batch[i] = plan->W[i / nl];
+            plan->IW_batch[i] = plan->IW[i / nl];
+            plan->W_batch_shoup[i] = plan->W_shoup[i / nl];
+            plan->IW_batch_shoup[i] = plan->IW_shoup[i / nl];
+        }
+    }
+}
+
+// free the plan's tables
+void ntt_plan_bfly_free(ntt_plan_bfly_t* plan) {
+    ntt_i_free(plan->mem);
+    *plan = NTT_PLAN_BFLY_EMPTY;
+}
+
+// the number of threads a single transform of this plan is split across
+static int bfly_threads(ntt_plan_bfly_t* plan) {
+    // for small transforms, starting the threads for every pass costs more than it saves
+    return plan->N >= NTT_BFLY_MT_MIN_N && plan->nthreads > 1 ? plan->nthreads : 1;
+}
+
+// copy the first 'n' elements of 'inp' to 'out', reducing every element into [0, p), and
+//   zero the rest of 'out' (so 'inp' only needs 'n' elements)
+static void copy_reduce(ntt_plan_bfly_t* plan, int64_t* out, int64_t* inp, int64_t n) {
+    int64_t N = plan->N, p = plan->p;
+    int nt = bfly_threads(plan);
+
     int64_t i;
+    #pragma omp parallel for num_threads(nt) if(nt > 1)
     for (i = 0; i < N; ++i) {
-        plan->W[i] = Wi;
-        plan->IW[i] = Wi_inv;
-        Wi = ntt_modmul(Wi, w, p);
-        Wi_inv = ntt_modmul(Wi_inv, w_inv, p);
+        out[i] = i < n ? ntt_i_reduce(inp[i], p) : 0;
+    }
+}
+
+// copy 'inp' to 'out' like 'copy_reduce', but also putting it in bit (or digit) reversed order
+static void copy_reduce_reversed(ntt_plan_bfly_t* plan, int64_t* out, int64_t* inp) {
+    if (plan->perm == NULL) {
+        copy_reduce(plan, out, inp, plan->N);
+        shuffle_bitrev(out, plan->N);
+        return;
+    }
+
+    // the permutation can't be done in place, so then 'inp' is copied to the scratch buffer
+    //   first (otherwise, this gathers straight from 'inp')
+    if (inp == out) {
+        memcpy(plan->tmp, inp, sizeof(*inp) * plan->N);
+        inp = plan->tmp;
     }
 
-    //memcpy(plan->W_br, plan->W, sizeof(*plan->W) * N);
-    //shuffle_bitrev(plan->W_br, N);
+    int64_t p = plan->p;
+    int nt = bfly_threads(plan);
+
+    int64_t i;
+    #pragma omp parallel for num_threads(nt) if(nt > 1)
+    for (i = 0; i < plan->N; ++i) {
+        out[i] = ntt_i_reduce(inp[plan->perm[i]], p);
+    }
 }
 
-// Do forward NTT:
-// out = NTT(inp)
-void ntt_plan_bfly_NTT(ntt_plan_bfly_t* plan, int64_t* inp, int64_t* out) {
-    // do in place on output
-    memcpy(out, inp, sizeof(*inp) * plan->N);
-    shuffle_bitrev(out, plan->N);
+// DIT (Cooley-Tukey) butterfly: (U, V) -> (U + wV, U - wV)
+// If 'lazy', values are kept in [0, 4p) (which requires p < 2^62), otherwise [0, p)
+static inline void dit_bfly(uint64_t* U, uint64_t* V, uint64_t w, uint64_t w_shoup, uint64_t p, bool lazy) {
+    uint64_t u = *U, v;
+    if (lazy) {
+        // u in [0, 2p), v in [0, 2p)
+        if (u >= 2 * p) u -= 2 * p;
+        v = ntt_i_mulshoup_lazy(*V, w, w_shoup, p);
+
+        // both outputs are in [0, 4p)
+        *U = u + v;
+        *V = u + 2 * p - v;
+    } else {
+        v = ntt_i_mulshoup(*V, w, w_shoup, p);
+
+        // u, v are in [0, p), so only a single correction is needed
+        *U = u + v >= p ? u + v - p : u + v;
+        *V = u >= v ? u - v : u + p - v;
+    }
+}
 
-    // store plan variables as locals
-    int64_t N = plan->N, p = plan->p;
+// DIT butterfly with w = 1, which needs no multiply
+static inline void dit_bfly1(uint64_t* U, uint64_t* V, uint64_t p, bool lazy) {
+    uint64_t u = *U, v = *V;
+    if (lazy) {
+        if (u >= 2 * p) u -= 2 * p;
+        if (v >= 2 * p) v -= 2 * p;
+        *U = u + v;
+        *V = u + 2 * p - v;
+    } else {
+        *U = u + v >= p ? u + v - p : u + v;
+        *V = u >= v ? u - v : u + p - v;
+    }
+}
 
-    // temporary variables
-    int64_t i, j, U, V;
+// DIF (Gentleman-Sande) butterfly: (U, V) -> (U + V, w(U - V))
+// If 'lazy', values are kept in [0, 2p) (which requires p < 2^62), otherwise [0, p)
+static inline void dif_bfly(uint64_t* U, uint64_t* V, uint64_t w, uint64_t w_shoup, uint64_t p, bool lazy) {
+    uint64_t u = *U, v = *V;
+    if (lazy) {
+        *U = u + v >= 2 * p ? u + v - 2 * p : u + v;
+        *V = ntt_i_mulshoup_lazy(u + 2 * p - v, w, w_shoup, p);
+    } else {
+        *U = u + v >= p ? u + v - p : u + v;
+        *V = ntt_i_mulshoup(u + p - v, w, w_shoup, p);
+    }
+}
 
-    // current transform size (powers of 2)
-    int64_t m = 1;
+// DIF butterfly with w = 1, which needs no multiply
+static inline void dif_bfly1(uint64_t* U, uint64_t* V, uint64_t p, bool lazy) {
+    uint64_t u = *U, v = *V;
+    if (lazy) {
+        *U = u + v >= 2 * p ? u + v - 2 * p : u + v;
+        *V = u >= v ? u - v : u + 2 * p - v;
+    } else {
+        *U = u + v >= p ? u + v - p : u + v;
+        *V = u >= v ? u - v : u + p - v;
+    }
+}
 
-    while (m <= N) {
-        int64_t m2 = m / 2;
-        int64_t bnd = (N / m) * m;
+// run a single radix-2 DIT stage of half-size 'm2' in place on 'x' (of length N), with
+//   the stage-contiguous twiddles W[m2 + i] (and their Shoup quotients), but only for
+//   the butterflies with i in [i0, i1) of each block
+static void dit_stage(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy) {
+    int64_t i, k;
+    for (k = 0; k < N; k += 2 * m2) {
+        for (i = i0; i < i1; ++i) {
+            dit_bfly(&x[k + i], &x[k + i + m2], W[m2 + i], W_shoup[m2 + i], p, lazy);
+        }
+    }
+}
 
-        for (i = 0; i < m2; ++i) {
-            // current root of unity
-            int64_t wi = plan->W[i * N / m];
+// run a single radix-2 DIF stage of half-size 'm2', with the same conventions as 'dit_stage'
+static void dif_stage(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy) {
+    int64_t i, k;
+    for (k = 0; k < N; k += 2 * m2) {
+        for (i = i0; i < i1; ++i) {
+            dif_bfly(&x[k + i], &x[k + i + m2], W[m2 + i], W_shoup[m2 + i], p, lazy);
+        }
+    }
+}
 
-            // interio transform
-            for (j = i; j < bnd + i; j += m) {
-                U = out[j];
-                V = (out[j + m2] * wi) % p;
+// run a radix-4 DIT pass, which fuses the stages of half-size 'm2' and '2*m2' into
+//   a single sweep over memory
+static void dit4_stage(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy) {
+    int64_t i, k;
+
+    if (m2 == 1 && i0 == 0 && i1 == 1) {
+        // the first pass has w1 = w2 = 1, and w3 = w_4, the 4th root of unity, so
+        //   only one constant multiply is required per 4 points
+        uint64_t w4 = W[3], w4_shoup = W_shoup[3];
+        for (k = 0; k < N; k += 4) {
+            dit_bfly1(&x[k], &x[k + 1], p, lazy);
+            dit_bfly1(&x[k + 2], &x[k + 3], p, lazy);
+            dit_bfly1(&x[k], &x[k + 2], p, lazy);
+            dit_bfly(&x[k + 1], &x[k + 3], w4, w4_shoup, p, lazy);
+        }
+        return;
+    }
 
-                out[j] = (((U + V) % p) + p) % p;
-                out[j + m2] = (((U - V) % p) + p) % p;
-            }
+    for (k = 0; k < N; k += 4 * m2) {
+        uint64_t* restrict x0 = &x[k], * restrict x1 = &x[k + m2];
+        uint64_t* restrict x2 = &x[k + 2 * m2], * restrict x3 = &x[k + 3 * m2];
+        for (i = i0; i < i1; ++i) {
+            // work on locals, so that the compiler can vectorize this
+            uint64_t a0 = x0[i], a1 = x1[i], a2 = x2[i], a3 = x3[i];
+            dit_bfly(&a0, &a1, W[m2 + i], W_shoup[m2 + i], p, lazy);
+            dit_bfly(&a2, &a3, W[m2 + i], W_shoup[m2 + i], p, lazy);
+            dit_bfly(&a0, &a2, W[2 * m2 + i], W_shoup[2 * m2 + i], p, lazy);
+            dit_bfly(&a1, &a3, W[3 * m2 + i], W_shoup[3 * m2 + i], p, lazy);
+            x0[i] = a0; x1[i] = a1; x2[i] = a2; x3[i] = a3;
         }
+    }
+}
 
-        // keep growing up the transform size
-        m *= 2;
+// run a radix-4 DIF pass, which fuses the stages of half-size '2*m2' and 'm2'
+static void dif4_stage(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy) {
+    int64_t i, k;
+
+    if (m2 == 1 && i0 == 0 && i1 == 1) {
+        // the last pass has w1 = w2 = 1, and w3 = w_4 (see 'dit4_stage')
+        uint64_t w4 = W[3], w4_shoup = W_shoup[3];
+        for (k = 0; k < N; k += 4) {
+            dif_bfly1(&x[k], &x[k + 2], p, lazy);
+            dif_bfly(&x[k + 1], &x[k + 3], w4, w4_shoup, p, lazy);
+            dif_bfly1(&x[k], &x[k + 1], p, lazy);
+            dif_bfly1(&x[k + 2], &x[k + 3], p, lazy);
+        }
+        return;
     }
 
-    // adjust for modulo 'p'
-    for (i = 0; i < plan->N; ++i) {
-        if (out[i] < 0) out[i] += p;
+    for (k = 0; k < N; k += 4 * m2) {
+        uint64_t* restrict x0 = &x[k], * restrict x1 = &x[k + m2];
+        uint64_t* restrict x2 = &x[k + 2 * m2], * restrict x3 = &x[k + 3 * m2];
+        for (i = i0; i < i1; ++i) {
+            uint64_t a0 = x0[i], a1 = x1[i], a2 = x2[i], a3 = x3[i];
+            dif_bfly(&a0, &a2, W[2 * m2 + i], W_shoup[2 * m2 + i], p, lazy);
+            dif_bfly(&a1, &a3, W[3 * m2 + i], W_shoup[3 * m2 + i], p, lazy);
+            dif_bfly(&a0, &a1, W[m2 + i], W_shoup[m2 + i], p, lazy);
+            dif_bfly(&a2, &a3, W[m2 + i], W_shoup[m2 + i], p, lazy);
+            x0[i] = a0; x1[i] = a1; x2[i] = a2; x3[i] = a3;
+        }
+    }
+}
+
+// run a single DIT stage (if 'radix' is 2), or pass (if 'radix' is 4, fusing the stages
+//   'm2' and '2*m2'), on the butterflies i in [i0, i1) of each block of 'x' (of length 'N'),
+//   using the SIMD kernels if the stage is wide enough for them
+static void dit_range(ntt_plan_bfly_t* plan, uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, int radix, int64_t* W, uint64_t* W_shoup, bool lazy) {
+    uint64_t p = plan->p;
+
+    // how many coefficients the SIMD kernels work on at once (or 0 if they can't be used)
+    int vw = ntt_i_isa_width(plan->isa, p);
+
+    if (vw > 0 && m2 >= vw) {
+#ifdef NTT_I_X86
+        if (radix == 4) {
+            /**/ if (plan->isa == NTT_ISA_AVX512IFMA) ntt_i_dit4_stage_avx512ifma(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+            else if (plan->isa == NTT_ISA_AVX512) ntt_i_dit4_stage_avx512(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+            else ntt_i_dit4_stage_avx2(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+        } else {
+            /**/ if (plan->isa == NTT_ISA_AVX512IFMA) ntt_i_dit_stage_avx512ifma(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+            else if (plan->isa == NTT_ISA_AVX512) ntt_i_dit_stage_avx512(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+            else ntt_i_dit_stage_avx2(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+        }
+#endif
+    } else if (radix == 4) {
+        dit4_stage(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+    } else {
+        dit_stage(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+    }
+}
+
+// run a single DIF stage or pass, with the same conventions as 'dit_range'
+static void dif_range(ntt_plan_bfly_t* plan, uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, int radix, int64_t* W, uint64_t* W_shoup, bool lazy) {
+    uint64_t p = plan->p;
+
+    int vw = ntt_i_isa_width(plan->isa, p);
+
+    if (vw > 0 && m2 >= vw) {
+#ifdef NTT_I_X86
+        if (radix == 4) {
+            /**/ if (plan->isa == NTT_ISA_AVX512IFMA) ntt_i_dif4_stage_avx512ifma(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+            else if (plan->isa == NTT_ISA_AVX512) ntt_i_dif4_stage_avx512(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+            else ntt_i_dif4_stage_avx2(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+        } else {
+            /**/ if (plan->isa == NTT_ISA_AVX512IFMA) ntt_i_dif_stage_avx512ifma(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+            else if (plan->isa == NTT_ISA_AVX512) ntt_i_dif_stage_avx512(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+            else ntt_i_dif_stage_avx2(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+        }
+#endif
+    } else if (radix == 4) {
+        dif4_stage(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+    } else {
+        dif_stage(x, N, m2, i0, i1, W, W_shoup, p, lazy);
+    }
+}
+
+// run a single DIT or DIF (if 'dif') stage/pass over all of 'x', split across the plan's threads
+// Only the first 'n' butterflies of each block are done (all of them if n >= m2), which is
+//   used to skip the ones that are known to be zero, or unneeded (see 'bfly_dif')
+static void bfly_pass(ntt_plan_bfly_t* plan, uint64_t* x, int64_t N, int64_t m2, int radix, int64_t* W, uint64_t* W_shoup, bool lazy, bool dif, int64_t n) {
+    int nt = bfly_threads(plan);
+
+    // only the first 'n' butterflies of each block are needed (see 'bfly_dif'), but the SIMD
+    //   kernels want whole vectors, so do a few extra
+    int64_t i_end = n < m2 ? (n + 7) & ~7LL : m2;
+    if (i_end > m2) i_end = m2;
+
+    if (nt == 1) {
+        if (dif) dif_range(plan, x, N, m2, 0, i_end, radix, W, W_shoup, lazy);
+        else dit_range(plan, x, N, m2, 0, i_end, radix, W, W_shoup, lazy);
+        return;
+    }
+
+    // size and number of the independent blocks in this pass
+    int64_t bs = radix * m2, nb = N / bs;
+
+    int t;
+    if (nb >= nt) {
+        // early (DIT) or late (DIF) passes have lots of small blocks, so each thread gets
+        //   a contiguous range of whole blocks
+        #pragma omp parallel for num_threads(nt)
+        for (t = 0; t < nt; ++t) {
+            int64_t b0 = nb * t / nt, b1 = nb * (t + 1) / nt;
+            if (dif) dif_range(plan, x + b0 * bs, (b1 - b0) * bs, m2, 0, i_end, radix, W, W_shoup, lazy);
+            else dit_range(plan, x + b0 * bs, (b1 - b0) * bs, m2, 0, i_end, radix, W, W_shoup, lazy);
+        }
+    } else {
+        // otherwise, there are only a few huge blocks, so the butterflies inside each block are
+        //   split up instead (on multiples of 8, so the SIMD kernels get whole vectors)
+        #pragma omp parallel for num_threads(nt)
+        for (t = 0; t < nt; ++t) {
+            int64_t i0 = (i_end * t / nt) & ~7LL;
+            int64_t i1 = t == nt - 1 ? i_end : (i_end * (t + 1) / nt) & ~7LL;
+            if (dif) dif_range(plan, x, N, m2, i0, i1, radix, W, W_shoup, lazy);
+            else dit_range(plan, x, N, m2, i0, i1, radix, W, W_shoup, lazy);
+        }
+    }
+}
+
+// x + y (mod p), for x, y in [0, p)
+static inline uint64_t addmod(uint64_t x, uint64_t y, uint64_t p) {
+    return x + y >= p ? x + y - p : x + y;
+}
+
+// x - y (mod p), for x, y in [0, p)
+static inline uint64_t submod(uint64_t x, uint64_t y, uint64_t p) {
+    return x >= y ? x - y : x + p - y;
+}
+
+// radix-3 DFT of (a0, a1, a2) in place, with the constants R = { -1/2, (w_3 - w_3^2)/2 }:
+//   y1 = a0 + w a1 + w^2 a2 = a0 - (a1 + a2)/2 + (w - w^2)/2 (a1 - a2), and y2 is the same,
+//   but subtracting the last term, so only 2 multiplies are needed
+static inline void dft3(uint64_t* a, const uint64_t* R, const uint64_t* R_shoup, uint64_t p) {
+    uint64_t s = addmod(a[1], a[2], p), d = submod(a[1], a[2], p);
+    uint64_t u = addmod(a[0], ntt_i_mulshoup(s, R[0], R_shoup[0], p), p);
+    uint64_t v = ntt_i_mulshoup(d, R[1], R_shoup[1], p);
+    a[0] = addmod(a[0], s, p);
+    a[1] = addmod(u, v, p);
+    a[2] = submod(u, v, p);
+}
+
+// radix-5 DFT of (a0, ..., a4) in place, with the constants R = { (w + w^4)/2, (w^2 + w^3)/2,
+//   (w - w^4)/2, (w^2 - w^3)/2 } (where w = w_5), which pairs up (a1, a4) and (a2, a3) the
+//   same way as 'dft3', needing 8 multiplies instead of 16
+static inline void dft5(uint64_t* a, const uint64_t* R, const uint64_t* R_shoup, uint64_t p) {
+    uint64_t s1 = addmod(a[1], a[4], p), d1 = submod(a[1], a[4], p);
+    uint64_t s2 = addmod(a[2], a[3], p), d2 = submod(a[2], a[3], p);
+
+    uint64_t A1 = addmod(a[0], addmod(ntt_i_mulshoup(s1, R[0], R_shoup[0], p), ntt_i_mulshoup(s2, R[1], R_shoup[1], p), p), p);
+    uint64_t A2 = addmod(a[0], addmod(ntt_i_mulshoup(s1, R[1], R_shoup[1], p), ntt_i_mulshoup(s2, R[0], R_shoup[0], p), p), p);
+    uint64_t B1 = addmod(ntt_i_mulshoup(d1, R[2], R_shoup[2], p), ntt_i_mulshoup(d2, R[3], R_shoup[3], p), p);
+    uint64_t B2 = submod(ntt_i_mulshoup(d1, R[3], R_shoup[3], p), ntt_i_mulshoup(d2, R[2], R_shoup[2], p), p);
+
+    a[0] = addmod(a[0], addmod(s1, s2, p), p);
+    a[1] = addmod(A1, B1, p);
+    a[4] = submod(A1, B1, p);
+    a[2] = addmod(A2, B2, p);
+    a[3] = submod(A2, B2, p);
+}
+
+// the radix-3/5 DIF butterflies for i in [i0, i1) of each block of length 'r * m' (see 'dif_rad_stage')
+static void dif_rad_range(uint64_t* x, int64_t N, int64_t m, int64_t i0, int64_t i1, int r, const int64_t* W, const uint64_t* W_shoup, const uint64_t* R, const uint64_t* R_shoup, uint64_t p) {
+    int64_t k, i;
+    int s;
+    for (k = 0; k < N; k += r * m) {
+        for (i = i0; i < i1; ++i) {
+            uint64_t a[5];
+            for (s = 0; s < r; ++s) a[s] = x[k + i + s * m];
+
+            if (r == 3) dft3(a, R, R_shoup, p);
+            else dft5(a, R, R_shoup, p);
+
+            x[k + i] = a[0];
+            for (s = 1; s < r; ++s) x[k + i + s * m] = ntt_i_mulshoup(a[s], W[s * m + i], W_shoup[s * m + i], p);
+        }
+    }
+}
+
+// the radix-3/5 DIT butterflies for i in [i0, i1) of each block of length 'r * m' (see 'dit_rad_stage')
+static void dit_rad_range(uint64_t* x, int64_t N, int64_t m, int64_t i0, int64_t i1, int r, const int64_t* W, const uint64_t* W_shoup, const uint64_t* R, const uint64_t* R_shoup, uint64_t p) {
+    int64_t k, i;
+    int s;
+    for (k = 0; k < N; k += r * m) {
+        for (i = i0; i < i1; ++i) {
+            uint64_t a[5];
+
+            // the inputs may be lazy, in [0, 4p)
+            a[0] = x[k + i];
+            if (a[0] >= 2 * p) a[0] -= 2 * p;
+            if (a[0] >= p) a[0] -= p;
+            for (s = 1; s < r; ++s) a[s] = ntt_i_mulshoup(x[k + i + s * m], W[s * m + i], W_shoup[s * m + i], p);
+
+            if (r == 3) dft3(a, R, R_shoup, p);
+            else dft5(a, R, R_shoup, p);
+
+            for (s = 0; s < r; ++s) x[k + i + s * m] = a[s];
+        }
+    }
+}
+
+// run a radix-3 or radix-5 DIF stage in place on 'x', on the blocks of length L = r * m, where
+//   each butterfly is a small DFT of x[k + i + s * m] (for s < r), after which output 's'
+//   is multiplied by the twiddle W[s * m + i] = w_L^(s * i). 'R' are the constants for the
+//   small DFT (see 'R3' and 'R5')
+// If 'dit', this does the inverse (when given the inverse twiddles and constants), up to a
+//   factor of 'r', multiplying by the twiddles first and then doing the small DFT
+// Only the first 'n' butterflies of each block are done, like 'bfly_pass'
+// NOTE: these use the exact reductions, so the output is in [0, p) (and the DIT input may be
+//   lazy, in [0, 4p))
+static void rad_stage(ntt_plan_bfly_t* plan, uint64_t* x, int64_t m, int r, const int64_t* W, const uint64_t* W_shoup, const int64_t* R, bool dit, int64_t n) {
+    int64_t N = plan->N;
+    uint64_t p = plan->p;
+    int nt = bfly_threads(plan);
+
+    uint64_t Ru[4], R_shoup[4];
+    int t;
+    for (t = 0; t < (r == 3 ? 2 : 4); ++t) {
+        Ru[t] = R[t];
+        R_shoup[t] = ntt_i_shoup(R[t], p);
+    }
+
+    // split either the blocks, or the butterflies inside them, across threads (like 'bfly_pass')
+    int64_t bs = r * m, nb = N / bs, i_end = n < m ? n : m;
+    #pragma omp parallel for num_threads(nt) if(nt > 1)
+    for (t = 0; t < nt; ++t) {
+        if (nb >= nt) {
+            int64_t b0 = nb * t / nt, b1 = nb * (t + 1) / nt;
+            if (dit) dit_rad_range(x + b0 * bs, (b1 - b0) * bs, m, 0, i_end, r, W, W_shoup, Ru, R_shoup, p);
+            else dif_rad_range(x + b0 * bs, (b1 - b0) * bs, m, 0, i_end, r, W, W_shoup, Ru, R_shoup, p);
+        } else {
+            int64_t i0 = i_end * t / nt, i1 = i_end * (t + 1) / nt;
+            if (dit) dit_rad_range(x, N, m, i0, i1, r, W, W_shoup, Ru, R_shoup, p);
+            else dif_rad_range(x, N, m, i0, i1, r, W, W_shoup, Ru, R_shoup, p);
+        }
+    }
+}
+
+// run all the DIT stages in place on 'out' (which is in bit (or digit) reversed order, and
+//   reduced into [0, p)), with the stage-contiguous twiddle table 'W' (and its Shoup
+//   quotients), or the inverse ones if 'inv'
+// If 'nl' > 1, 'out' holds nl interleaved transforms (out[j * nl + v] is element 'j' of
+//   transform 'v'), and the expanded twiddles are used (see 'W_batch')
+// Only the first 'n' outputs are computed (for a full transform, n = N), and the rest are
+//   left as garbage. Since each stage only needs the first 'n' outputs of each block from the
+//   stage before it, the butterflies that only lead to the others are skipped
+// NOTE: if 'lazy', the output is only reduced into [0, 4p)
+static void bfly_dit(ntt_plan_bfly_t* plan, int64_t* out, int64_t nl, bool inv, bool lazy, int64_t n) {
+    // cast to unsigned, since lazy values may be >= 2^63 in intermediate steps
+    uint64_t* x = (uint64_t*)out;
+    int64_t N = plan->N, n2 = plan->N_pow2;
+
+    int64_t* W = nl > 1 ? (inv ? plan->IW_batch : plan->W_batch) : (inv ? plan->IW : plan->W);
+    uint64_t* W_shoup = nl > 1 ? (inv ? plan->IW_batch_shoup : plan->W_batch_shoup) : (inv ? plan->IW_shoup : plan->W_shoup);
+
+    // current half transform size (powers of 2)
+    int64_t m2 = 1;
+
+    // the power of 2 stages are done on every block of length 'n2' at once
+    if (plan->radix == 4) {
+        // finish off an odd number of stages with a single radix-2 stage
+        int64_t lgN = 0;
+        while ((1LL << lgN) < n2) lgN++;
+        if (lgN % 2 == 1) {
+            bfly_pass(plan, x, N * nl, m2 * nl, 2, W, W_shoup, lazy, false, (n < m2 ? n : m2) * nl);
+            m2 *= 2;
+        }
+
+        for (; m2 < n2; m2 *= 4) {
+            bfly_pass(plan, x, N * nl, m2 * nl, 4, W, W_shoup, lazy, false, (n < m2 ? n : m2) * nl);
+        }
+    } else {
+        for (; m2 < n2; m2 *= 2) {
+            bfly_pass(plan, x, N * nl, m2 * nl, 2, W, W_shoup, lazy, false, (n < m2 ? n : m2) * nl);
+        }
+    }
+
+    // then, the radix-3/5 stages, in the opposite order to 'bfly_dif'
+    int rs[64], n_rs = mixed_radices(plan, rs), t;
+    int64_t m = n2;
+    for (t = n_rs - 1; t >= 0; --t) {
+        const int64_t* R = rs[t] == 5 ? (inv ? plan->IR5 : plan->R5) : (inv ? plan->IR3 : plan->R3);
+        rad_stage(plan, x, m, rs[t], W, W_shoup, R, true, n);
+        m *= rs[t];
+    }
+}
+
+// run all the DIF stages in place on 'out' (which is in natural order, and reduced
+//   into [0, p)), leaving the result in bit (or digit) reversed order
+// Only the first 'n' inputs may be nonzero (for a full transform, n = N), and the rest must
+//   be 0. Then, each block only has nonzeros in its first 'n' elements after every stage, so
+//   the butterflies which only see zeros are skipped
+// NOTE: if 'lazy', the output is only reduced into [0, 2p)
+static void bfly_dif(ntt_plan_bfly_t* plan, int64_t* out, int64_t nl, bool inv, bool lazy, int64_t n) {
+    uint64_t* x = (uint64_t*)out;
+    int64_t N = plan->N, n2 = plan->N_pow2;
+
+    int64_t* W = nl > 1 ? (inv ? plan->IW_batch : plan->W_batch) : (inv ? plan->IW : plan->W);
+    uint64_t* W_shoup = nl > 1 ? (inv ? plan->IW_batch_shoup : plan->W_batch_shoup) : (inv ? plan->IW_shoup : plan->W_shoup);
+
+    // the radix-3/5 stages go first, which leaves independent blocks of length 'n2'
+    int rs[64], n_rs = mixed_radices(plan, rs), t;
+    int64_t m = N;
+    for (t = 0; t < n_rs; ++t) {
+        const int64_t* R = rs[t] == 5 ? (inv ? plan->IR5 : plan->R5) : (inv ? plan->IR3 : plan->R3);
+        m /= rs[t];
+        rad_stage(plan, x, m, rs[t], W, W_shoup, R, false, n);
+        if (n > m) n = m;
+    }
+
+    // current half transform size (powers of 2, but going down)
+    int64_t m2 = n2 / 2;
+
+    if (plan->radix == 4) {
+        for (; m2 >= 2; m2 /= 4) {
+            bfly_pass(plan, x, N * nl, (m2 / 2) * nl, 4, W, W_shoup, lazy, true, n * nl);
+            if (n > m2 / 2) n = m2 / 2;
+        }
+
+        // finish off an odd number of stages with a single radix-2 stage
+        if (m2 == 1) {
+            bfly_pass(plan, x, N * nl, m2 * nl, 2, W, W_shoup, lazy, true, n * nl);
+        }
+    } else {
+        for (; m2 >= 1; m2 /= 2) {
+            bfly_pass(plan, x, N * nl, m2 * nl, 2, W, W_shoup, lazy, true, n * nl);
+            if (n > m2) n = m2;
+        }
+    }
+}
+
+// reduce the first 'n' lazy values in 'out' (which are in [0, 4p)) into [0, p)
+static void normalize(ntt_plan_bfly_t* plan, int64_t* out, int64_t n) {
+    uint64_t* x = (uint64_t*)out;
+    uint64_t p = plan->p;
+    int nt = bfly_threads(plan);
+
+    int64_t i;
+    #pragma omp parallel for num_threads(nt) if(nt > 1)
+    for (i = 0; i < n; ++i) {
+        if (x[i] >= 2 * p) x[i] -= 2 * p;
+        if (x[i] >= p) x[i] -= p;
     }
+}
+
+// multiply the first 'n' values by the corrective factor N^-1 (which also normalizes lazy
+//   values, since the Shoup multiply accepts any 64 bit input)
+static void scale_N_inv(ntt_plan_bfly_t* plan, int64_t* out, int64_t n) {
+    int nt = bfly_threads(plan);
 
+    int64_t i;
+    #pragma omp parallel for num_threads(nt) if(nt > 1)
+    for (i = 0; i < n; ++i) {
+        out[i] = ntt_i_mulshoup(out[i], plan->N_inv, plan->N_inv_shoup, plan->p);
+    }
+}
+
+// Do forward NTT:
+// out = NTT(inp)
+void ntt_plan_bfly_NTT(ntt_plan_bfly_t* plan, int64_t* inp, int64_t* out) {
+    // do in place on output
+    copy_reduce_reversed(plan, out, inp);
+
+    bool lazy = plan->lazy && plan->p < (1LL << 62);
+    bfly_dit(plan, out, 1, false, lazy, plan->N);
+
+    // a single normalization pass from [0, 4p) to [0, p)
+    if (lazy) normalize(plan, out, plan->N);
 }
 
 // Do inverse NTT (INTT):
 // out = INTT(inp)
 void ntt_plan_bfly_INTT(ntt_plan_bfly_t* plan, int64_t* inp, int64_t* out) {
     // do in place on output
-    memcpy(out, inp, sizeof(*inp) * plan->N);
-    shuffle_bitrev(out, plan->N);
+    copy_reduce_reversed(plan, out, inp);
 
-    // store plan variables as locals
-    int64_t N = plan->N, p = plan->p;
+    bfly_dit(plan, out, 1, true, plan->lazy && plan->p < (1LL << 62), plan->N);
+    scale_N_inv(plan, out, plan->N);
+}
+
+// Do forward NTT, leaving the result in bit reversed order:
+// out = bitrev(NTT(inp))
+void ntt_plan_bfly_NTT_bitrev(ntt_plan_bfly_t* plan, int64_t* inp, int64_t* out) {
+    ntt_plan_bfly_NTT_bitrev_pruned(plan, inp, plan->N, out);
+}
 
-    // temp indicies/values
-    int64_t i, j, U, V;
+// Do inverse NTT (INTT), taking the input in bit reversed order:
+// out = INTT(bitrev(inp))
+void ntt_plan_bfly_INTT_bitrev(ntt_plan_bfly_t* plan, int64_t* inp, int64_t* out) {
+    ntt_plan_bfly_INTT_bitrev_pruned(plan, inp, out, plan->N);
+}
 
-    // current transform stride
-    int64_t m = 2;
+// Do forward NTT, where only the first 'n_in' inputs may be nonzero:
+// out = bitrev(NTT(inp[:n_in] + [0] * (N - n_in)))
+void ntt_plan_bfly_NTT_bitrev_pruned(ntt_plan_bfly_t* plan, int64_t* inp, int64_t n_in, int64_t* out) {
+    if (n_in > plan->N) n_in = plan->N;
+    copy_reduce(plan, out, inp, n_in);
 
-    while (m <= N) {
-        // temporary variables for saving
-        int64_t m2 = m / 2;
-        int64_t bnd = (N / m) * m;
+    bool lazy = plan->lazy && plan->p < (1LL << 62);
+    bfly_dif(plan, out, 1, false, lazy, n_in);
 
-        for (i = 0; i < m2; ++i) {
-            // current root of unity
-            int64_t wi = plan->IW[i * N / m];
+    if (lazy) normalize(plan, out, plan->N);
+}
 
-            // calculate interior butterfly
-            for (j = i; j < bnd + i; j += m) {
-                U = out[j];
-                V = (out[j + m2] * wi) % p;
+// Do inverse NTT, computing only the first 'n_out' outputs:
+// out[:n_out] = INTT(bitrev(inp))[:n_out]
+void ntt_plan_bfly_INTT_bitrev_pruned(ntt_plan_bfly_t* plan, int64_t* inp, int64_t* out, int64_t n_out) {
+    if (n_out > plan->N) n_out = plan->N;
+    copy_reduce(plan, out, inp, plan->N);
 
-                out[j] = (((U + V) % p) + p) % p;
-                out[j + m2] = (((U - V) % p) + p) % p;
+    bfly_dit(plan, out, 1, true, plan->lazy && plan->p < (1LL << 62), n_out);
+    scale_N_inv(plan, out, n_out);
+}
+
+// do 'count' forward (or inverse, if 'inv') transforms, with the layout described
+//   in 'ntt_plan_bfly_NTT_batch'
+static void bfly_batch(ntt_plan_bfly_t* plan, int64_t count, int64_t* inp, int64_t istride, int64_t idist, int64_t* out, int64_t ostride, int64_t odist, bool inv) {
+    int64_t N = plan->N, p = plan->p;
+    int nt = plan->nthreads > 1 ? plan->nthreads : 1;
+    int64_t v;
+
+    if (plan->W_batch == NULL) {
+        // large transforms already fill the vectors, so just do them one at a time
+        //   (and, if they are split across threads already, don't split the batch too)
+        bool mt = bfly_threads(plan) > 1;
+        #pragma omp parallel num_threads(nt) if(nt > 1 && !mt)
+        {
+            // NOTE: the transforms are never done in place here, since for the mixed radix
+            //   sizes, those use the plan's scratch buffer (which the threads share)
+            int64_t* tmp = malloc(sizeof(*tmp) * 2 * N), *tmp2 = tmp + N;
+            int64_t j;
+
+            #pragma omp for
+            for (v = 0; v < count; ++v) {
+                int64_t* x = &inp[v * idist], *y = &out[v * odist];
+                if (istride == 1 && ostride == 1 && x != y) {
+                    if (inv) ntt_plan_bfly_INTT(plan, x, y);
+                    else ntt_plan_bfly_NTT(plan, x, y);
+                } else {
+                    for (j = 0; j < N; ++j) tmp[j] = inp[v * idist + j * istride];
+                    if (inv) ntt_plan_bfly_INTT(plan, tmp, tmp2);
+                    else ntt_plan_bfly_NTT(plan, tmp, tmp2);
+                    for (j = 0; j < N; ++j) out[v * odist + j * ostride] = tmp2[j];
+                }
             }
+
+            free(tmp);
         }
+        return;
+    }
+
+    // number of transforms interleaved at a time
+    int64_t nl = NTT_BFLY_BATCH_L;
 
-        m *= 2;
+    bool lazy = plan->lazy && plan->p < (1LL << 62);
+
+    // the DIF transform leaves the output in bit reversed order, so it's undone while
+    //   scattering the results back out
+    int64_t* rev = malloc(sizeof(*rev) * N);
+    int64_t j, lgN = 0;
+    while ((1LL << lgN) < N) lgN++;
+    for (j = 0; j < N; ++j) {
+        int64_t b, r = 0;
+        for (b = 0; b < lgN; ++b) r |= ((j >> b) & 1) << (lgN - 1 - b);
+        rev[j] = r;
     }
 
-    // now, multiply by corrective force and adjust modulo 'p'
-    for (i = 0; i < plan->N; ++i) {
-        out[i] = (out[i] * plan->N_inv) % p;
-        if (out[i] < 0) out[i] += p;
+    int64_t g, n_groups = (count + nl - 1) / nl;
+
+    #pragma omp parallel num_threads(nt) if(nt > 1)
+    {
+        // interleaved buffer, tmp[j * nl + l] is element 'j' of transform 'v0 + l'
+        int64_t* tmp = malloc(sizeof(*tmp) * N * nl);
+
+        #pragma omp for
+        for (g = 0; g < n_groups; ++g) {
+            int64_t v0 = g * nl, nv = count - v0 < nl ? count - v0 : nl;
+            int64_t jj, l;
+
+            // gather (padding a partial group with zeros)
+            for (jj = 0; jj < N; ++jj) {
+                for (l = 0; l < nv; ++l) tmp[jj * nl + l] = ntt_i_reduce(inp[(v0 + l) * idist + jj * istride], p);
+                for (; l < nl; ++l) tmp[jj * nl + l] = 0;
+            }
+
+            bfly_dif(plan, tmp, nl, inv, lazy, N);
+
+            // scatter, either normalizing or scaling by N^-1
+            uint64_t* x = (uint64_t*)tmp;
+            for (jj = 0; jj < N; ++jj) {
+                int64_t k = rev[jj];
+                for (l = 0; l < nv; ++l) {
+                    uint64_t y = x[jj * nl + l];
+                    if (inv) {
+                        y = ntt_i_mulshoup(y, plan->N_inv, plan->N_inv_shoup, p);
+                    } else {
+                        if (y >= (uint64_t)p) y -= p;
+                    }
+                    out[(v0 + l) * odist + k * ostride] = y;
+                }
+            }
+        }
+
+        free(tmp);
     }
+
+    free(rev);
 }
 
+// Do many forward NTTs:
+// out[v] = NTT(inp[v])
+void ntt_plan_bfly_NTT_batch(ntt_plan_bfly_t* plan, int64_t count, int64_t* inp, int64_t istride, int64_t idist, int64_t* out, int64_t ostride, int64_t odist) {
+    bfly_batch(plan, count, inp, istride, idist, out, ostride, odist, false);
+}
+
+// Do many inverse NTTs (INTTs):
+// out[v] = INTT(inp[v])
+void ntt_plan_bfly_INTT_batch(ntt_plan_bfly_t* plan, int64_t count, int64_t* inp, int64_t istride, int64_t idist, int64_t* out, int64_t ostride, int64_t odist) {
+    bfly_batch(plan, count, inp, istride, idist, out, ostride, odist, true);
+}
@@ -0,0 +1,145 @@
+/* bfly_simd.c - vectorized butterfly kernels (AVX2, AVX-512, AVX-512 IFMA)
+ *
+ * Every kernel is compiled with a 'target' attribute, so the library can be built
+ *   with generic flags, and the best kernel is picked at plan-init time by
+ *   'ntt_isa_detect()'
+ *
+ * The AVX2 and AVX-512 kernels use 32x32->64 bit multiplies, with the 32 bit Shoup
+ *   quotient (which is just the high half of the 64 bit one), so they require p < 2^30.
+ * The IFMA kernel uses 52 bit multiplies, with the 52 bit Shoup quotient, so it
+ *   requires p < 2^50
+ *
+ * The kernel loops themselves are in 'bfly_simd_kern.h', which is included once per ISA
+ *
+ */
+
+#include "ntt.h"
+#include "ntt-impl.h"
+
+
+// Detect the best instruction set supported by the current CPU (and OS)
+ntt_isa_t ntt_isa_detect() {
+#ifdef NTT_I_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma")) return NTT_ISA_AVX512IFMA;
+    if (__builtin_cpu_supports("avx512f")) return NTT_ISA_AVX512;
+    if (__builtin_cpu_supports("avx2")) return NTT_ISA_AVX2;
+#endif
+    return NTT_ISA_SCALAR;
+}
+
+// Return the number of 64 bit lanes the kernels for 'isa' process at once, or
+//   0 if they can't handle the modulus 'p'
+int ntt_i_isa_width(ntt_isa_t isa, uint64_t p) {
+#ifdef NTT_I_X86
+    if (isa == NTT_ISA_AVX512IFMA && p < (1ULL << 50)) return 8;
+    if (isa >= NTT_ISA_AVX512 && p < (1ULL << 30)) return 8;
+    if (isa >= NTT_ISA_AVX2 && p < (1ULL << 30)) return 4;
+#endif
+    return 0;
+}
+
+
+#ifdef NTT_I_X86
+
+#include <immintrin.h>
+
+
+/* AVX2 */
+
+// x*w (mod p) in [0, 2p), where 'wq' is the 32 bit Shoup quotient
+__attribute__((target("avx2"))) static inline __m256i avx2_mulshoup_lazy(__m256i x, __m256i w, __m256i wq, __m256i p) {
+    __m256i q = _mm256_srli_epi64(_mm256_mul_epu32(x, wq), 32);
+    return _mm256_sub_epi64(_mm256_mul_epu32(x, w), _mm256_mul_epu32(q, p));
+}
+
+// x - p if x >= p, else x
+__attribute__((target("avx2"))) static inline __m256i avx2_csub(__m256i x, __m256i p) {
+    // all lanes are < 2^63, so the signed compare is fine
+    __m256i lt = _mm256_cmpgt_epi64(p, x);
+    return _mm256_sub_epi64(x, _mm256_andnot_si256(lt, p));
+}
+
+#define KERN(name) name##_avx2
+#define ATTR __attribute__((target("avx2")))
+#define VW 4
+#define VEC __m256i
+#define V_LOAD(ptr) _mm256_loadu_si256((const __m256i*)(ptr))
+#define V_STORE(ptr, v) _mm256_storeu_si256((__m256i*)(ptr), (v))
+#define V_SET1(x) _mm256_set1_epi64x(x)
+#define V_ADD(a, b) _mm256_add_epi64((a), (b))
+#define V_SUB(a, b) _mm256_sub_epi64((a), (b))
+#define V_CSUB(x, p) avx2_csub((x), (p))
+#define V_QUOT(ptr) _mm256_srli_epi64(V_LOAD(ptr), 32)
+#define V_MULSHOUP(x, w, wq, p) avx2_mulshoup_lazy((x), (w), (wq), (p))
+
+#include "bfly_simd_kern.h"
+
+#undef KERN
+#undef ATTR
+#undef VW
+#undef VEC
+#undef V_LOAD
+#undef V_STORE
+#undef V_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_CSUB
+#undef V_QUOT
+#undef V_MULSHOUP
+
+
+/* AVX-512 */
+
+// x*w (mod p) in [0, 2p), where 'wq' is the 32 bit Shoup quotient
+__attribute__((target("avx512f"))) static inline __m512i avx512_mulshoup_lazy(__m512i x, __m512i w, __m512i wq, __m512i p) {
+    __m512i q = _mm512_srli_epi64(_mm512_mul_epu32(x, wq), 32);
+    return _mm512_sub_epi64(_mm512_mul_epu32(x, w), _mm512_mul_epu32(q, p));
+}
+
+// x - p if x >= p, else x (if x < p, then x - p wraps around to be larger than x)
+__attribute__((target("avx512f"))) static inline __m512i avx512_csub(__m512i x, __m512i p) {
+    return _mm512_min_epu64(x, _mm512_sub_epi64(x, p));
+}
+
+#define KERN(name) name##_avx512
+#define ATTR __attribute__((target("avx512f")))
+#define VW 8
+#define VEC __m512i
+#define V_LOAD(ptr) _mm512_loadu_si512((const void*)(ptr))
+#define V_STORE(ptr, v) _mm512_storeu_si512((void*)(ptr), (v))
+#define V_SET1(x) _mm512_set1_epi64(x)
+#define V_ADD(a, b) _mm512_add_epi64((a), (b))
+#define V_SUB(a, b) _mm512_sub_epi64((a), (b))
+#define V_CSUB(x, p) avx512_csub((x), (p))
+#define V_QUOT(ptr) _mm512_srli_epi64(V_LOAD(ptr), 32)
+#define V_MULSHOUP(x, w, wq, p) avx512_mulshoup_lazy((x), (w), (wq), (p))
+
+#include "bfly_simd_kern.h"
+
+#undef KERN
+#undef ATTR
+#undef V_QUOT
+#undef V_MULSHOUP
+
+
+/* AVX-512 IFMA (shares the AVX-512 definitions, except for the multiply) */
+
+// x*w (mod p) in [0, 2p), where 'wq' is the 52 bit Shoup quotient
+__attribute__((target("avx512f,avx512ifma"))) static inline __m512i ifma_mulshoup_lazy(__m512i x, __m512i w, __m512i wq, __m512i p) {
+    __m512i zero = _mm512_setzero_si512();
+    __m512i q = _mm512_madd52hi_epu64(zero, x, wq);
+    // the true result is < 2p < 2^52, so the low 52 bits are enough
+    __m512i r = _mm512_sub_epi64(_mm512_madd52lo_epu64(zero, x, w), _mm512_madd52lo_epu64(zero, q, p));
+    return _mm512_and_si512(r, _mm512_set1_epi64((1ULL << 52) - 1));
+}
+
+#define KERN(name) name##_avx512ifma
+#define ATTR __attribute__((target("avx512f,avx512ifma")))
+#define V_QUOT(ptr) _mm512_srli_epi64(V_LOAD(ptr), 12)
+#define V_MULSHOUP(x, w, wq, p) ifma_mulshoup_lazy((x), (w), (wq), (p))
+
+#include "bfly_simd_kern.h"
+
+#endif /* NTT_I_X86 */
@@ -0,0 +1,156 @@
+/* bfly_simd_kern.h - template for the vectorized butterfly kernels
+ *
+ * This file is included once per instruction set by 'bfly_simd.c', which defines:
+ *
+ *   KERN(name)         - the kernel name with an ISA suffix
+ *   ATTR               - the function attribute enabling the ISA
+ *   VW                 - the number of lanes per vector
+ *   VEC                - the vector type
+ *   V_LOAD(ptr)        - unaligned load
+ *   V_STORE(ptr, v)    - unaligned store
+ *   V_SET1(x)          - broadcast
+ *   V_ADD(a, b)        - lane-wise a + b
+ *   V_SUB(a, b)        - lane-wise a - b
+ *   V_CSUB(x, p)       - lane-wise x - p if x >= p, else x
+ *   V_QUOT(ptr)        - load Shoup quotients, shifted to the width the multiply expects
+ *   V_MULSHOUP(x, w, wq, p) - lane-wise x * w (mod p), in [0, 2p)
+ *
+ * And optionally, the element types (which default to the 64 bit ones):
+ *
+ *   T_X                - the coefficient type
+ *   T_W                - the twiddle type
+ *   T_WQ               - the Shoup quotient type
+ *
+ * All the kernels work on 'x' (of length N) in place, with the stage-contiguous twiddle
+ *   table 'W' (and its Shoup quotients), where the stage of half-size 'm2' uses W[m2 + i].
+ *   Only the butterflies with i in [i0, i1) of each block are done (so that threads can
+ *   split up the blocks), and i0, i1 must be multiples of VW
+ * If 'lazy', DIT values are kept in [0, 4p), and DIF values in [0, 2p). Otherwise, they are
+ *   kept fully reduced in [0, p)
+ *
+ */
+
+#ifndef T_X
+#define T_X uint64_t
+#define T_W int64_t
+#define T_WQ uint64_t
+#endif
+
+
+// DIT (Cooley-Tukey) butterfly: (U, V) -> (U + wV, U - wV)
+ATTR static inline void KERN(dit_bfly)(VEC* U, VEC* V, VEC w, VEC wq, VEC vp, VEC vp2, bool lazy) {
+    VEC u = *U, v = V_MULSHOUP(*V, w, wq, vp);
+    if (lazy) {
+        u = V_CSUB(u, vp2);
+        *U = V_ADD(u, v);
+        *V = V_SUB(V_ADD(u, vp2), v);
+    } else {
+        v = V_CSUB(v, vp);
+        *U = V_CSUB(V_ADD(u, v), vp);
+        *V = V_CSUB(V_SUB(V_ADD(u, vp), v), vp);
+    }
+}
+
+// DIF (Gentleman-Sande) butterfly: (U, V) -> (U + V, w(U - V))
+ATTR static inline void KERN(dif_bfly)(VEC* U, VEC* V, VEC w, VEC wq, VEC vp, VEC vp2, bool lazy) {
+    VEC u = *U, v = *V;
+    if (lazy) {
+        *U = V_CSUB(V_ADD(u, v), vp2);
+        *V = V_MULSHOUP(V_SUB(V_ADD(u, vp2), v), w, wq, vp);
+    } else {
+        *U = V_CSUB(V_ADD(u, v), vp);
+        *V = V_CSUB(V_MULSHOUP(V_SUB(V_ADD(u, vp), v), w, wq, vp), vp);
+    }
+}
+
+// radix-2 DIT stage of half-size 'm2'
+ATTR void KERN(ntt_i_dit_stage)(T_X* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const T_W* W, const T_WQ* W_shoup, T_X p, bool lazy) {
+    VEC vp = V_SET1(p), vp2 = V_SET1(2 * p);
+
+    int64_t k, i;
+    for (k = 0; k < N; k += 2 * m2) {
+        for (i = i0; i < i1; i += VW) {
+            VEC w = V_LOAD(&W[m2 + i]), wq = V_QUOT(&W_shoup[m2 + i]);
+
+            VEC U = V_LOAD(&x[k + i]), V = V_LOAD(&x[k + i + m2]);
+            KERN(dit_bfly)(&U, &V, w, wq, vp, vp2, lazy);
+            V_STORE(&x[k + i], U);
+            V_STORE(&x[k + i + m2], V);
+        }
+    }
+}
+
+// radix-2 DIF stage of half-size 'm2'
+ATTR void KERN(ntt_i_dif_stage)(T_X* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const T_W* W, const T_WQ* W_shoup, T_X p, bool lazy) {
+    VEC vp = V_SET1(p), vp2 = V_SET1(2 * p);
+
+    int64_t k, i;
+    for (k = 0; k < N; k += 2 * m2) {
+        for (i = i0; i < i1; i += VW) {
+            VEC w = V_LOAD(&W[m2 + i]), wq = V_QUOT(&W_shoup[m2 + i]);
+
+            VEC U = V_LOAD(&x[k + i]), V = V_LOAD(&x[k + i + m2]);
+            KERN(dif_bfly)(&U, &V, w, wq, vp, vp2, lazy);
+            V_STORE(&x[k + i], U);
+            V_STORE(&x[k + i + m2], V);
+        }
+    }
+}
+
+// radix-4 DIT pass, which fuses the stages of half-size 'm2' and '2*m2'
+ATTR void KERN(ntt_i_dit4_stage)(T_X* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const T_W* W, const T_WQ* W_shoup, T_X p, bool lazy) {
+    VEC vp = V_SET1(p), vp2 = V_SET1(2 * p);
+
+    int64_t k, i;
+    for (k = 0; k < N; k += 4 * m2) {
+        for (i = i0; i < i1; i += VW) {
+            VEC w1 = V_LOAD(&W[m2 + i]), w1q = V_QUOT(&W_shoup[m2 + i]);
+            VEC w2 = V_LOAD(&W[2 * m2 + i]), w2q = V_QUOT(&W_shoup[2 * m2 + i]);
+            VEC w3 = V_LOAD(&W[3 * m2 + i]), w3q = V_QUOT(&W_shoup[3 * m2 + i]);
+
+            VEC a0 = V_LOAD(&x[k + i]), a1 = V_LOAD(&x[k + i + m2]);
+            VEC a2 = V_LOAD(&x[k + i + 2 * m2]), a3 = V_LOAD(&x[k + i + 3 * m2]);
+
+            KERN(dit_bfly)(&a0, &a1, w1, w1q, vp, vp2, lazy);
+            KERN(dit_bfly)(&a2, &a3, w1, w1q, vp, vp2, lazy);
+            KERN(dit_bfly)(&a0, &a2, w2, w2q, vp, vp2, lazy);
+            KERN(dit_bfly)(&a1, &a3, w3, w3q, vp, vp2, lazy);
+
+            V_STORE(&x[k + i], a0);
+            V_STORE(&x[k + i + m2], a1);
+            V_STORE(&x[k + i + 2 * m2], a2);
+            V_STORE(&x[k + i + 3 * m2], a3);
+        }
+    }
+}
+
+// radix-4 DIF pass, which fuses the stages of half-size '2*m2' and 'm2'
+ATTR void KERN(ntt_i_dif4_stage)(T_X* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const T_W* W, const T_WQ* W_shoup, T_X p, bool lazy) {
+    VEC vp = V_SET1(p), vp2 = V_SET1(2 * p);
+
+    int64_t k, i;
+    for (k = 0; k < N; k += 4 * m2) {
+        for (i = i0; i < i1; i += VW) {
+            VEC w1 = V_LOAD(&W[m2 + i]), w1q = V_QUOT(&W_shoup[m2 + i]);
+            VEC w2 = V_LOAD(&W[2 * m2 + i]), w2q = V_QUOT(&W_shoup[2 * m2 + i]);
+            VEC w3 = V_LOAD(&W[3 * m2 + i]), w3q = V_QUOT(&W_shoup[3 * m2 + i]);
+
+            VEC a0 = V_LOAD(&x[k + i]), a1 = V_LOAD(&x[k + i + m2]);
+            VEC a2 = V_LOAD(&x[k + i + 2 * m2]), a3 = V_LOAD(&x[k + i + 3 * m2]);
+
+            KERN(dif_bfly)(&a0, &a2, w2, w2q, vp, vp2, lazy);
+            KERN(dif_bfly)(&a1, &a3, w3, w3q, vp, vp2, lazy);
+            KERN(dif_bfly)(&a0, &a1, w1, w1q, vp, vp2, lazy);
+            KERN(dif_bfly)(&a2, &a3, w1, w1q, vp, vp2, lazy);
+
+            V_STORE(&x[k + i], a0);
+            V_STORE(&x[k + i + m2], a1);
+            V_STORE(&x[k + i + 2 * m2], a2);
+            V_STORE(&x[k + i + 3 * m2], a3);
+        }
+    }
+}
+
+#undef T_X
+#undef T_W
+#undef T_WQ
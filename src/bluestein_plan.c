@@ -0,0 +1,155 @@
+/* bluestein_plan.c - Bluestein's (chirp-z) NTT, for arbitrary lengths
+ *
+ * Since jk = (j^2 + k^2 - (k - j)^2) / 2, the transform can be written as:
+ *
+ *   X[k] = c[k] * sum(x[j] * c[j] * c[k - j]^-1), where c[j] = w_2N^(j^2)
+ *
+ * Which is a convolution, so it is done with power of 2 butterfly transforms of size
+ *   M >= 2N - 1 (with the same 'p'). This is ~3x the work of a butterfly plan of
+ *   a nearby size, so it should only be used when N can't be changed
+ *
+ */
+
+#include "ntt.h"
+#include "ntt-impl.h"
+
+
+// initialize Bluestein plan
+void ntt_plan_bluestein_init(ntt_plan_bluestein_t* plan, int64_t N, int64_t p) {
+
+    // convolution size
+    int64_t M = 1;
+    while (M < 2 * N - 1) M *= 2;
+
+    // 'p' needs both 2N'th roots of unity (for the chirp), and M'th ones (for the convolution)
+    int64_t lcm = M / ntt_gcd(M, 2 * N) * 2 * N;
+
+    // take 'p' from the built-in table (see 'ntt_plan_bfly_init'), or search for one
+    if (p == 0) p = ntt_prime_lookup(lcm, 30, 0, NULL);
+    if (p == 0) {
+        p = lcm + 1;
+        while (!ntt_isprime(p)) p += lcm;
+    }
+
+    // save NTT data
+    plan->N = N;
+    plan->p = p;
+    plan->N_inv = ntt_modinv(N, p);
+    plan->M = M;
+
+    ntt_plan_bfly_init(&plan->plan_M, M, p);
+    plan->plan_M.lazy = true;
+
+    // allocate tables, and the scratch buffer (from a single aligned arena)
+    size_t csz = sizeof(*plan->C) * N, bsz = sizeof(*plan->B) * M;
+    ntt_i_free(plan->mem);
+    plan->mem = ntt_i_alloc(4 * ntt_i_aligned(csz) + 5 * ntt_i_aligned(bsz));
+    char* cur = plan->mem;
+    plan->C = ntt_i_carve(&cur, csz);
+    plan->IC = ntt_i_carve(&cur, csz);
+    plan->C_shoup = ntt_i_carve(&cur, csz);
+    plan->IC_shoup = ntt_i_carve(&cur, csz);
+    plan->B = ntt_i_carve(&cur, bsz);
+    plan->IB = ntt_i_carve(&cur, bsz);
+    plan->B_shoup = ntt_i_carve(&cur, bsz);
+    plan->IB_shoup = ntt_i_carve(&cur, bsz);
+    plan->tmp = ntt_i_carve(&cur, bsz);
+
+    // w_2N (whose square is the same root of unity that the butterfly plans use)
+    int64_t rt_p = ntt_prim_root_unity(p);
+    int64_t w = ntt_modpow(rt_p, (p - 1) / (2 * N), p);
+    int64_t w_inv = ntt_modinv(w, p);
+
+    // c[j] = w_2N^(j^2), using (j+1)^2 = j^2 + 2j + 1
+    int64_t j, cj = 1, cj_inv = 1, step = w, step_inv = w_inv, w2 = ntt_modmul(w, w, p), w2_inv = ntt_modmul(w_inv, w_inv, p);
+    for (j = 0; j < N; ++j) {
+        plan->C[j] = cj;
+        plan->IC[j] = cj_inv;
+        cj = ntt_modmul(cj, step, p);
+        cj_inv = ntt_modmul(cj_inv, step_inv, p);
+        step = ntt_modmul(step, w2, p);
+        step_inv = ntt_modmul(step_inv, w2_inv, p);
+    }
+
+    // the filters are c^-1 (for the forward transform) and c (for the inverse), wrapped
+    //   around for negative indices
+    for (j = 0; j < M; ++j) plan->B[j] = plan->IB[j] = 0;
+    for (j = 0; j < N; ++j) {
+        plan->B[j] = plan->IC[j];
+        plan->IB[j] = plan->C[j];
+        if (j > 0) {
+            plan->B[M - j] = plan->IC[j];
+            plan->IB[M - j] = plan->C[j];
+        }
+    }
+
+    // transform them ahead of time (in bit reversed order, since only pointwise products
+    //   are done with them), and fold N^-1 into the inverse one
+    ntt_plan_bfly_NTT_bitrev(&plan->plan_M, plan->B, plan->B);
+    ntt_plan_bfly_NTT_bitrev(&plan->plan_M, plan->IB, plan->IB);
+
+    uint64_t N_inv_shoup = ntt_i_shoup(plan->N_inv, p);
+    for (j = 0; j < M; ++j) {
+        plan->IB[j] = ntt_i_mulshoup(plan->IB[j], plan->N_inv, N_inv_shoup, p);
+        plan->B_shoup[j] = ntt_i_shoup(plan->B[j], p);
+        plan->IB_shoup[j] = ntt_i_shoup(plan->IB[j], p);
+    }
+    for (j = 0; j < N; ++j) {
+        plan->C_shoup[j] = ntt_i_shoup(plan->C[j], p);
+        plan->IC_shoup[j] = ntt_i_shoup(plan->IC[j], p);
+    }
+}
+
+// do the transform, with either the forward or inverse chirp and filter
+static void bluestein(ntt_plan_bluestein_t* plan, int64_t* inp, int64_t* out, bool inv) {
+    int64_t N = plan->N, M = plan->M;
+    uint64_t p = plan->p;
+
+    int64_t* C = inv ? plan->IC : plan->C;
+    uint64_t* C_shoup = inv ? plan->IC_shoup : plan->C_shoup;
+    int64_t* B = inv ? plan->IB : plan->B;
+    uint64_t* B_shoup = inv ? plan->IB_shoup : plan->B_shoup;
+
+    int64_t* a = plan->tmp;
+
+    // a = x * c, padded with zeros
+    int64_t j;
+    for (j = 0; j < N; ++j) {
+        int64_t x = inp[j] % (int64_t)p;
+        if (x < 0) x += p;
+        a[j] = ntt_i_mulshoup(x, C[j], C_shoup[j], p);
+    }
+    for (; j < M; ++j) a[j] = 0;
+
+    // convolve with the filter
+    ntt_plan_bfly_NTT_bitrev(&plan->plan_M, a, a);
+    for (j = 0; j < M; ++j) {
+        a[j] = ntt_i_mulshoup(a[j], B[j], B_shoup[j], p);
+    }
+    ntt_plan_bfly_INTT_bitrev(&plan->plan_M, a, a);
+
+    // and multiply by the chirp again
+    for (j = 0; j < N; ++j) {
+        out[j] = ntt_i_mulshoup(a[j], C[j], C_shoup[j], p);
+    }
+
+}
+
+// free the plan's tables (and the convolution plan)
+void ntt_plan_bluestein_free(ntt_plan_bluestein_t* plan) {
+    ntt_plan_bfly_free(&plan->plan_M);
+    ntt_i_free(plan->mem);
+    *plan = NTT_PLAN_BLUESTEIN_EMPTY;
+}
+
+// Do forward NTT:
+// out = NTT(inp)
+void ntt_plan_bluestein_NTT(ntt_plan_bluestein_t* plan, int64_t* inp, int64_t* out) {
+    bluestein(plan, inp, out, false);
+}
+
+// Do inverse NTT (INTT):
+// out = INTT(inp)
+void ntt_plan_bluestein_INTT(ntt_plan_bluestein_t* plan, int64_t* inp, int64_t* out) {
+    bluestein(plan, inp, out, true);
+}
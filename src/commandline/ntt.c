@@ -158,6 +158,20 @@ static int64_t readhexint(char* src, int64_t** to, int hdpw) {
     return oi;
 }
 
+// pack the 'n' hex digits (least significant first) of 'X' into words of 'hdpw' hex digits
+//   each, in place, and return the number of words
+static int64_t packhexint(int64_t* X, int64_t n, int hdpw) {
+    int64_t i, j, nw = (n + hdpw - 1) / hdpw;
+    for (i = 0; i < nw; ++i) {
+        int64_t word = 0;
+        for (j = hdpw - 1; j >= 0; --j) {
+            word = word * 16 + (i * hdpw + j < n ? X[i * hdpw + j] : 0);
+        }
+        X[i] = word;
+    }
+    return nw;
+}
+
 
 
 
@@ -172,6 +186,7 @@ int main(int argc, char** argv) {
         fprintf(stderr, "   ntt [file] [p=0]:      calculates the NTT of an sequence of integers from a file (optional modulus p)\n");
         fprintf(stderr, "   intt [file] [p=0]:     calculates the INTT of an sequence of integers from a file (optional modulus p)\n");
         fprintf(stderr, "   mul [A] [B]            Uses 'NTT' to calculate A*B\n");
+        fprintf(stderr, "   mulhex [A] [B] [gl]    Uses 'NTT' to calculate A*B, for hex integers in files (optionally, mod the Goldilocks prime)\n");
         
         return 1;
     }
@@ -193,36 +208,40 @@ int main(int argc, char** argv) {
             return 1;
         }
 
-        if ((N & (N - 1)) != 0) {
-            fprintf(stderr, "Sequence length must be a power of 2! (got N=%lli)\n", (long long int)N);
-            free(x);
-            return 1;
-        }
+        // lengths that aren't 2^a * 3^b * 5^c need Bluestein's algorithm, which needs 'p' to
+        //   have 2N'th roots of unity, as well as M'th ones (for its convolution of size M)
+        bool smooth = ntt_smooth_size(N) == N;
+        int64_t M = 1;
+        while (M < 2 * N - 1) M *= 2;
 
         if (argc >= 4) {
             long long int p_read = 0;
             sscanf(argv[3], "%lli", &p_read);
             p = p_read;
-            if (!ntt_isprime(p) || p % N != 1) {
+            if (!ntt_isprime(p) || (smooth ? p % N != 1 : (p % (2 * N) != 1 || p % M != 1))) {
                 fprintf(stderr, "Invalid choice 'p' (given %lli) for N=%lli\n", p_read, N);
                 free(x);
                 return 1;
             }
-        } else {
-            // generate it
-            p = N + 1;
-            while (!ntt_isprime(p)) {
-                p += N;
-            }
         }
 
-        // now, calculate plan
-        ntt_plan_bfly_t plan_B = NTT_PLAN_BFLY_EMPTY;
-        ntt_plan_bfly_init(&plan_B, N, p);
-
         int64_t* ntt_x = malloc(sizeof(*ntt_x) * N);
 
-        ntt_plan_bfly_NTT(&plan_B, x, ntt_x);
+        // now, calculate plan (which generates 'p' if it is 0)
+        if (smooth) {
+            ntt_plan_bfly_t plan_B = NTT_PLAN_BFLY_EMPTY;
+            ntt_plan_bfly_init(&plan_B, N, p);
+            plan_B.nthreads = ntt_num_threads();
+
+            ntt_plan_bfly_NTT(&plan_B, x, ntt_x);
+            ntt_plan_bfly_free(&plan_B);
+        } else {
+            ntt_plan_bluestein_t plan_BS = NTT_PLAN_BLUESTEIN_EMPTY;
+            ntt_plan_bluestein_init(&plan_BS, N, p);
+
+            ntt_plan_bluestein_NTT(&plan_BS, x, ntt_x);
+            ntt_plan_bluestein_free(&plan_BS);
+        }
 
         // print it out
         int i;
@@ -252,31 +271,40 @@ int main(int argc, char** argv) {
             return 1;
         }
 
-        if ((N & (N - 1)) != 0) {
-            fprintf(stderr, "Sequence length must be a power of 2! (got N=%lli)\n", (long long int)N);
-            free(x);
-            return 1;
-        }
+        // lengths that aren't 2^a * 3^b * 5^c need Bluestein's algorithm, which needs 'p' to
+        //   have 2N'th roots of unity, as well as M'th ones (for its convolution of size M)
+        bool smooth = ntt_smooth_size(N) == N;
+        int64_t M = 1;
+        while (M < 2 * N - 1) M *= 2;
 
         if (argc >= 4) {
             long long int p_read = 0;
             sscanf(argv[3], "%lli", &p_read);
             p = p_read;
-            if (!ntt_isprime(p) || p % N != 1) {
+            if (!ntt_isprime(p) || (smooth ? p % N != 1 : (p % (2 * N) != 1 || p % M != 1))) {
                 fprintf(stderr, "Invalid choice 'p' (given %lli) for N=%lli\n", p_read, N);
                 free(x);
                 return 1;
             }
-        } else {
         }
 
-        // now, calculate plan
-        ntt_plan_bfly_t plan_B = NTT_PLAN_BFLY_EMPTY;
-        ntt_plan_bfly_init(&plan_B, N, p);
-
         int64_t* ntt_x = malloc(sizeof(*ntt_x) * N);
 
-        ntt_plan_bfly_INTT(&plan_B, x, ntt_x);
+        // now, calculate plan (which generates 'p' if it is 0)
+        if (smooth) {
+            ntt_plan_bfly_t plan_B = NTT_PLAN_BFLY_EMPTY;
+            ntt_plan_bfly_init(&plan_B, N, p);
+            plan_B.nthreads = ntt_num_threads();
+
+            ntt_plan_bfly_INTT(&plan_B, x, ntt_x);
+            ntt_plan_bfly_free(&plan_B);
+        } else {
+            ntt_plan_bluestein_t plan_BS = NTT_PLAN_BLUESTEIN_EMPTY;
+            ntt_plan_bluestein_init(&plan_BS, N, p);
+
+            ntt_plan_bluestein_INTT(&plan_BS, x, ntt_x);
+            ntt_plan_bluestein_free(&plan_BS);
+        }
 
         // print it out
         int i;
@@ -294,99 +322,85 @@ int main(int argc, char** argv) {
     } else if (strcmp(cmd, "mulhex") == 0) {
         // read 2 hex numbers and multiply them
 
-        // hex digits per word
-        int hdpw = 2;
-
         // tmp vars
         int64_t i, j;
 
-        // our main variables, 'A' and 'B'
+        // our main variables, 'A' and 'B' (read as single hex digits, and then packed into
+        //   the limbs that the multiplier picks)
         int64_t* A = NULL, *B = NULL;
 
-        int64_t nA = readhexint(argv[2], &A, hdpw);
+        int64_t nA = readhexint(argv[2], &A, 1);
         if (nA < 1) {
             fprintf(stderr, "Could not get hex int from '%s'\n", argv[2]);
             return 1;
         }
-        int64_t nB = readhexint(argv[3], &B, hdpw);
+        int64_t nB = readhexint(argv[3], &B, 1);
         if (nB < 1) {
             fprintf(stderr, "Could not get hex int from '%s'\n", argv[3]);
             return 1;
         }
 
-        // calculate the required transform size (rounded up to the next power of 2)
-        int64_t N = 1 << 2;
-        while (N < (nA + nB + 1)) {
-            N = N * 2;
+        // calculate the multiplication utility, which picks the limb width and primes for
+        //   the sizes (or, with 'gl', uses 8 bit limbs, the Goldilocks prime and 2^k)
+        ntt_multer_t multer = NTT_MULTER_EMPTY;
+        int hdpw;
+        if (argc > 4 && strcmp(argv[4], "gl") == 0) {
+            hdpw = 2;
+            nA = packhexint(A, nA, hdpw);
+            nB = packhexint(B, nB, hdpw);
+            ntt_multer_init_gl(&multer, nA + nB + 1);
+        } else {
+            ntt_multer_init_bits(&multer, 4 * nA, 4 * nB, ntt_isa_detect());
+            hdpw = multer.limb_bits / 4;
+            nA = packhexint(A, nA, hdpw);
+            nB = packhexint(B, nB, hdpw);
         }
 
-        // maximum limb residual
-        int64_t limb_res = 1ULL << (4 * hdpw);
-
-        // now, pad 'A' and 'B'
-        A = realloc(A, sizeof(*A) * N);
-        B = realloc(B, sizeof(*B) * N);
-
-        // pad with 0s
-        for (i = nA; i < N; ++i) A[i] = 0;
-        for (i = nB; i < N; ++i) B[i] = 0;
+        // the product has (at most) nA + nB words, which is all we need to compute (the
+        //   multiplier treats the rest of 'A' and 'B' as 0, so they don't need padding)
+        int64_t nC = nA + nB;
 
         // output variable
-        int64_t* C = malloc(sizeof(*C) * N);
-
-        // calculate the multiplication utility
-        ntt_multer_t multer = NTT_MULTER_EMPTY;
-        ntt_multer_init(&multer, N);
+        int64_t* C = malloc(sizeof(*C) * nC);
 
 
         /*
         printf("A: ");
-        printarr(A, N);
+        printarr(A, nA);
         printf("\n");
 
         printf("B: ");
-        printarr(B, N);
+        printarr(B, nB);
         printf("\n");
         */
 
-        /*
-        // print the transform size
-        printf("N = %lli\n", multer.N);
-
-        // debug the transform modulus(es)
-        printf("prod(p[:]) = %lli = ", multer.prod_p);
+        // print the configuration (to stderr, so the output is just the product)
+        fprintf(stderr, "N: %lli, limbs: %i bits, p: ", (long long int)multer.N, multer.limb_bits);
+        if (multer.use_gl) fprintf(stderr, "%llu", (unsigned long long)NTT_GL_P);
         for (i = 0; i < multer.n_plans; ++i) {
-            if (i > 0) printf(" * ");
-            printf("%lli", multer.plans[i].p);
+            if (i > 0) fprintf(stderr, " * ");
+            fprintf(stderr, "%lli", (long long int)multer.primes[i]);
         }
-        printf("\n");
-        */
+        fprintf(stderr, "\n");
         /* computation */
 
         double st = ntt_time();
 
-        // perform multiplication
-        ntt_multer_mult(&multer, A, B, C);
+        // perform multiplication (which also propagates the carries)
+        ntt_multer_mult_limbs(&multer, A, nA, B, nB, C, nC);
 
         st = ntt_time() - st;
         fprintf(stderr, "time: %.3lf\n", st);
 
-        // handle carry propogation
-        int64_t carry = 0;
-        for (i = 0; i < N; ++i) {
-            int64_t csum = C[i] + carry;
-            carry = csum / limb_res;
-            csum %= limb_res;
-            C[i] = csum;
-        }
+        ntt_multer_free(&multer);
 
         /*
         printf("C: ");
-        printarr(C, N);
+        printarr(C, nC);
         printf("\n");
         */
 
-        char* Cs = malloc(hdpw * N + 1);
+        char* Cs = malloc(hdpw * nC + 1);
 
         int out_i = 0;
 
@@ -394,7 +408,7 @@ int main(int argc, char** argv) {
         char tmps[256];
 
         // output hex string
-        for (i = 0; i < N; ++i) {
+        for (i = 0; i < nC; ++i) {
 
             uint64_t ci = C[i];
 
@@ -0,0 +1,190 @@
+/* fourstep_plan.c - four-step (Bailey's) NTT, for transforms larger than the cache
+ *
+ * The transform of size N = N1 * N2 is done as (the 'six-step' variant, which keeps
+ *   the input and output in natural order):
+ *
+ *   1. transpose the input (N1 x N2 -> N2 x N1)
+ *   2. N2 transforms of size N1 (on the rows)
+ *   3. multiply by twiddles w^(n2 * k1)
+ *   4. transpose (N2 x N1 -> N1 x N2)
+ *   5. N1 transforms of size N2 (on the rows)
+ *   6. transpose (N1 x N2 -> N2 x N1)
+ *
+ * Each sub-transform is about sqrt(N) in size, so it stays resident in the cache, and every
+ *   step is a single pass over memory (instead of log2(N) passes)
+ *
+ */
+
+#include "ntt.h"
+#include "ntt-impl.h"
+
+
+// size of the tiles used for transposing (in elements), so that a tile of
+//   both the source and destination fit in L1
+#define TRANSPOSE_TILE 32
+
+
+// transpose 'src' (which is 'rows' x 'cols', row-major) into 'dst' (which is 'cols' x 'rows')
+static void transpose(int64_t* dst, int64_t* src, int64_t rows, int64_t cols) {
+    int64_t ib;
+
+    #pragma omp parallel for
+    for (ib = 0; ib < rows; ib += TRANSPOSE_TILE) {
+        int64_t jb, i, j;
+        int64_t ie = ib + TRANSPOSE_TILE < rows ? ib + TRANSPOSE_TILE : rows;
+        for (jb = 0; jb < cols; jb += TRANSPOSE_TILE) {
+            int64_t je = jb + TRANSPOSE_TILE < cols ? jb + TRANSPOSE_TILE : cols;
+            for (i = ib; i < ie; ++i) {
+                for (j = jb; j < je; ++j) {
+                    dst[j * rows + i] = src[i * cols + j];
+                }
+            }
+        }
+    }
+}
+
+// initialize four-step plan
+void ntt_plan_fourstep_init(ntt_plan_fourstep_t* plan, int64_t N, int64_t p) {
+
+    // take 'p' from the built-in table (see 'ntt_plan_bfly_init'), or search for one
+    if (p == 0) p = ntt_prime_lookup(N, 30, 0, NULL);
+    if (p == 0) {
+        p = N + 1;
+        while (!ntt_isprime(p)) p += N;
+    }
+
+    // save NTT data
+    plan->N = N;
+    plan->p = p;
+    plan->N_inv = ntt_modinv(N, p);
+
+    // split N = N1 * N2, as evenly as possible (with N1 <= N2), where N1 is the largest
+    //   divisor of N that's at most sqrt(N) (so, both are 2^a * 3^b * 5^c, like N)
+    int64_t d;
+    plan->N1 = 1;
+    for (d = 2; d * d <= N; ++d) {
+        if (N % d == 0) plan->N1 = d;
+    }
+    plan->N2 = N / plan->N1;
+
+    // the sub-plans use the same 'p', so their roots of unity are powers of ours
+    ntt_plan_bfly_init(&plan->plan_N1, plan->N1, p);
+    ntt_plan_bfly_init(&plan->plan_N2, plan->N2, p);
+
+    // the results are always normalized, so they can use the faster path
+    plan->plan_N1.lazy = true;
+    plan->plan_N2.lazy = true;
+
+    // allocate twiddle tables, and the scratch buffer (from a single aligned arena)
+    size_t tsz = sizeof(*plan->W) * N;
+    ntt_i_free(plan->mem);
+    plan->mem = ntt_i_alloc(5 * ntt_i_aligned(tsz));
+    char* cur = plan->mem;
+    plan->W = ntt_i_carve(&cur, tsz);
+    plan->IW = ntt_i_carve(&cur, tsz);
+    plan->W_shoup = ntt_i_carve(&cur, tsz);
+    plan->IW_shoup = ntt_i_carve(&cur, tsz);
+    plan->tmp = ntt_i_carve(&cur, tsz);
+
+    // calculate roots of unity (in the same way as the butterfly plans, so the sub-plans'
+    //   roots are powers of ours)
+    int fixed = ntt_i_fixed_find(p);
+    int64_t rt_p = fixed >= 0 ? (int64_t)ntt_i_fixed[fixed].g : ntt_prim_root_unity(p);
+    int64_t w = ntt_modpow(rt_p, (p - 1) / N, p);
+    int64_t w_inv = ntt_modinv(w, p);
+
+    // W[n2 * N1 + k1] = w^(n2 * k1)
+    int64_t n2, k1;
+    int64_t Wn2 = 1, Wn2_inv = 1;
+    for (n2 = 0; n2 < plan->N2; ++n2) {
+        int64_t* row = &plan->W[n2 * plan->N1];
+        int64_t* irow = &plan->IW[n2 * plan->N1];
+
+        int64_t Wi = 1, Wi_inv = 1;
+        for (k1 = 0; k1 < plan->N1; ++k1) {
+            row[k1] = Wi;
+            irow[k1] = Wi_inv;
+            plan->W_shoup[n2 * plan->N1 + k1] = ntt_i_shoup(Wi, p);
+            plan->IW_shoup[n2 * plan->N1 + k1] = ntt_i_shoup(Wi_inv, p);
+            Wi = ntt_modmul(Wi, Wn2, p);
+            Wi_inv = ntt_modmul(Wi_inv, Wn2_inv, p);
+        }
+
+        Wn2 = ntt_modmul(Wn2, w, p);
+        Wn2_inv = ntt_modmul(Wn2_inv, w_inv, p);
+    }
+}
+
+// do the six steps, with either the forward or inverse sub-transforms and twiddles
+static void fourstep(ntt_plan_fourstep_t* plan, int64_t* inp, int64_t* out, bool inv) {
+    int64_t N1 = plan->N1, N2 = plan->N2;
+    uint64_t p = plan->p;
+
+    int64_t* W = inv ? plan->IW : plan->W;
+    uint64_t* W_shoup = inv ? plan->IW_shoup : plan->W_shoup;
+
+    // the transposes can't be done in place
+    if (inp == out) {
+        memcpy(plan->tmp, inp, sizeof(*inp) * plan->N);
+        inp = plan->tmp;
+    }
+
+    // 1. input is N1 x N2, 'out' becomes N2 x N1
+    transpose(out, inp, N1, N2);
+
+    // 2. and 3. transform each row (into 'tmp', since the sub-plans would use their own scratch
+    //   buffers for in place transforms, which the threads share), then multiply by twiddles
+    int64_t n2;
+    #pragma omp parallel for
+    for (n2 = 0; n2 < N2; ++n2) {
+        int64_t* row = &plan->tmp[n2 * N1];
+        if (inv) {
+            ntt_plan_bfly_INTT(&plan->plan_N1, &out[n2 * N1], row);
+        } else {
+            ntt_plan_bfly_NTT(&plan->plan_N1, &out[n2 * N1], row);
+        }
+
+        int64_t k1;
+        for (k1 = 0; k1 < N1; ++k1) {
+            row[k1] = ntt_i_mulshoup(row[k1], W[n2 * N1 + k1], W_shoup[n2 * N1 + k1], p);
+        }
+    }
+
+    // 4. 'out' becomes N1 x N2
+    transpose(out, plan->tmp, N2, N1);
+
+    // 5. transform each row (back into 'tmp')
+    int64_t k1;
+    #pragma omp parallel for
+    for (k1 = 0; k1 < N1; ++k1) {
+        if (inv) {
+            ntt_plan_bfly_INTT(&plan->plan_N2, &out[k1 * N2], &plan->tmp[k1 * N2]);
+        } else {
+            ntt_plan_bfly_NTT(&plan->plan_N2, &out[k1 * N2], &plan->tmp[k1 * N2]);
+        }
+    }
+
+    // 6. 'out' becomes N2 x N1, which is the natural order of the result
+    transpose(out, plan->tmp, N1, N2);
+}
+
+// free the plan's tables (and its sub-plans)
+void ntt_plan_fourstep_free(ntt_plan_fourstep_t* plan) {
+    ntt_plan_bfly_free(&plan->plan_N1);
+    ntt_plan_bfly_free(&plan->plan_N2);
+    ntt_i_free(plan->mem);
+    *plan = NTT_PLAN_FOURSTEP_EMPTY;
+}
+
+// Do forward NTT:
+// out = NTT(inp)
+void ntt_plan_fourstep_NTT(ntt_plan_fourstep_t* plan, int64_t* inp, int64_t* out) {
+    fourstep(plan, inp, out, false);
+}
+
+// Do inverse NTT (INTT):
+// out = INTT(inp)
+// NOTE: the sub-transforms scale by N1^-1 and N2^-1, which is N^-1 in total
+void ntt_plan_fourstep_INTT(ntt_plan_fourstep_t* plan, int64_t* inp, int64_t* out) {
+    fourstep(plan, inp, out, true);
+}
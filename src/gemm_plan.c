@@ -1,12 +1,15 @@
 /* gemm_plan.c - Matrix-Multiply based NTT plan */
 
 #include "ntt.h"
+#include "ntt-impl.h"
 
 // create plan with given size
-// if p==0, calcaulte it as the smallest prime of the form (Nk+1)
+// if p==0, take it from the built-in table (or calculate the smallest prime of the form (Nk+1))
 void ntt_plan_gemm_init(ntt_plan_gemm_t* plan, int64_t N, int64_t p) {
 
-    // search for appropriate 'p'
+    // take 'p' from the built-in table (which keeps products of 2 elements in 64 bits), or
+    //   search for one
+    if (p == 0) p = ntt_prime_lookup(N, 30, 0, NULL);
     if (p == 0) {
         p = N + 1;
         while (!ntt_isprime(p)) p += N;
@@ -22,9 +25,14 @@ void ntt_plan_gemm_init(ntt_plan_gemm_t* plan, int64_t N, int64_t p) {
     // calculate N^-1 (mod p)
     plan->N_inv = ntt_modinv(N, p);
 
-    // allocate the matrices for the forward and inverse transform
-    plan->mNTT = realloc(plan->mNTT, sizeof(*plan->mNTT) * N * N);
-    plan->mINTT = realloc(plan->mINTT, sizeof(*plan->mINTT) * N * N);
+    // allocate the matrices for the forward and inverse transform (from a single aligned
+    //   arena)
+    size_t msz = sizeof(*plan->mNTT) * N * N;
+    ntt_i_free(plan->mem);
+    plan->mem = ntt_i_alloc(2 * ntt_i_aligned(msz));
+    char* cur = plan->mem;
+    plan->mNTT = ntt_i_carve(&cur, msz);
+    plan->mINTT = ntt_i_carve(&cur, msz);
 
     // calculate a primitive root of unity
     int64_t rt_p = ntt_prim_root_unity(p);
@@ -52,6 +60,12 @@ void ntt_plan_gemm_init(ntt_plan_gemm_t* plan, int64_t N, int64_t p) {
     }
 }
 
+// free the plan's matrices
+void ntt_plan_gemm_free(ntt_plan_gemm_t* plan) {
+    ntt_i_free(plan->mem);
+    *plan = NTT_PLAN_GEMM_EMPTY;
+}
+
 
 // Do forward NTT:
 // out = NTT(inp)
@@ -114,5 +128,87 @@ void ntt_plan_gemm_INTT(ntt_plan_gemm_t* plan, int64_t* inp, int64_t* out) {
 }
 
 
+// create a 32 bit plan with given size (see 'ntt_plan_gemm_init')
+void ntt_plan_gemm32_init(ntt_plan_gemm32_t* plan, int64_t N, uint32_t p) {
+
+    // take 'p' from the built-in table, or search for one
+    if (p == 0) p = ntt_prime_lookup(N, 30, 0, NULL);
+    if (p == 0) {
+        int64_t pp = N + 1;
+        while (!ntt_isprime(pp)) pp += N;
+        assert(pp < (1LL << 31));
+        p = pp;
+    }
+    assert(p < (1U << 31) && (p - 1) % N == 0);
+
+    plan->N = N;
+    plan->p = p;
+    plan->N_inv = ntt_modinv(N, p);
+
+    // allocate the matrices (from a single aligned arena)
+    size_t msz = sizeof(*plan->mNTT) * N * N;
+    ntt_i_free(plan->mem);
+    plan->mem = ntt_i_alloc(2 * ntt_i_aligned(msz));
+    char* cur = plan->mem;
+    plan->mNTT = ntt_i_carve(&cur, msz);
+    plan->mINTT = ntt_i_carve(&cur, msz);
+
+    // the N'th root of unity, and its inverse
+    int64_t w = ntt_modpow(ntt_prim_root_unity(p), (p - 1) / N, p);
+    int64_t w_inv = ntt_modinv(w, p);
+
+    // the same matrices as the 64 bit plan, but each row is built up by multiplying, instead of
+    //   a 'ntt_modpow' per element
+    int64_t i, j;
+    for (i = 0; i < N; ++i) {
+        uint64_t wi = ntt_modpow(w, i, p), wi_inv = ntt_modpow(w_inv, i, p), x = 1, x_inv = 1;
+        for (j = 0; j < N; ++j) {
+            plan->mNTT[i * N + j] = x;
+            plan->mINTT[i * N + j] = x_inv;
+            x = x * wi % p;
+            x_inv = x_inv * wi_inv % p;
+        }
+    }
+}
 
+// free the plan's matrices
+void ntt_plan_gemm32_free(ntt_plan_gemm32_t* plan) {
+    ntt_i_free(plan->mem);
+    *plan = NTT_PLAN_GEMM32_EMPTY;
+}
 
+// out = M * inp (mod p), for an NxN matrix 'M'
+// Each product is < 2^63 (< 2^32 * 2^31), so the sum is only reduced once it reaches 2^63,
+//   instead of after every term
+static void gemm32_mv(uint32_t* M, int64_t N, uint32_t p, uint32_t* inp, uint32_t* out) {
+    int64_t i;
+    for (i = 0; i < N; ++i) {
+        uint32_t* row = &M[i * N];
+        uint64_t r = 0;
+
+        int64_t j;
+        for (j = 0; j < N; ++j) {
+            r += (uint64_t)row[j] * inp[j];
+            if (r >= (1ULL << 63)) r %= p;
+        }
+
+        out[i] = r % p;
+    }
+}
+
+// Do forward NTT:
+// out = NTT(inp)
+void ntt_plan_gemm32_NTT(ntt_plan_gemm32_t* plan, uint32_t* inp, uint32_t* out) {
+    gemm32_mv(plan->mNTT, plan->N, plan->p, inp, out);
+}
+
+// Do inverse NTT (INTT):
+// out = INTT(inp)
+void ntt_plan_gemm32_INTT(ntt_plan_gemm32_t* plan, uint32_t* inp, uint32_t* out) {
+    gemm32_mv(plan->mINTT, plan->N, plan->p, inp, out);
+
+    int64_t i;
+    for (i = 0; i < plan->N; ++i) {
+        out[i] = (uint64_t)out[i] * plan->N_inv % plan->p;
+    }
+}
@@ -0,0 +1,231 @@
+/* gl_plan.c - butterfly-based NTT code modulo the Goldilocks prime, p = 2^64 - 2^32 + 1
+ *
+ * Since 2^64 = 2^32 - 1 and 2^96 = -1 (mod p), a 128 bit product can be reduced with just a
+ *   few shifts, adds and subtracts, instead of a Shoup multiply (which needs precomputed
+ *   quotients, and 'p' < 2^63). See 'ntt_i_gl_reduce' in 'ntt-impl.h'
+ *
+ * NOTE: the twiddles of the stages with m2 <= 32 are all powers of 2 (since 8 is a 64'th root
+ *   of unity), but on x86_64, a shift and reduce measured slower than just multiplying (a
+ *   64x64 bit multiply is about as fast as the 128 bit shift, and 'x * 2^s' needs extra
+ *   branches on 's'). So, only the trivial twiddle w^0 = 1 is skipped
+ *
+ */
+
+#include "ntt.h"
+#include "ntt-impl.h"
+
+// a generator of the multiplicative group (mod p)
+#define GL_G 7
+
+
+// a^b (mod p)
+static uint64_t gl_pow(uint64_t a, uint64_t b) {
+    uint64_t r = 1;
+    while (b > 0) {
+        if (b & 1) r = ntt_i_gl_mul(r, a);
+        a = ntt_i_gl_mul(a, a);
+        b >>= 1;
+    }
+    return r;
+}
+
+// shuffle a sequence with bit-reversal index mapping
+static void shuffle_bitrev_gl(uint64_t* inp, int64_t N) {
+    int64_t i, j = 0;
+    for (i = 1; i < N; ++i) {
+        int64_t b = (N >> 1);
+        while (j >= b) {
+            j -= b;
+            b >>= 1;
+        }
+        j += b;
+        if (j > i) {
+            uint64_t t = inp[i];
+            inp[i] = inp[j];
+            inp[j] = t;
+        }
+    }
+}
+
+// initialize Goldilocks plan
+void ntt_plan_gl_init(ntt_plan_gl_t* plan, int64_t N) {
+    assert(N >= 1 && (N & (N - 1)) == 0 && N <= (1LL << 32));
+
+    // save NTT data
+    plan->N = N;
+    plan->N_inv = gl_pow(N, NTT_GL_P - 2);
+    plan->nthreads = 1;
+
+    // allocate twiddle tables (from a single aligned arena)
+    size_t tsz = sizeof(*plan->W) * N;
+    ntt_i_free(plan->mem);
+    plan->mem = ntt_i_alloc(2 * ntt_i_aligned(tsz));
+    char* cur = plan->mem;
+    plan->W = ntt_i_carve(&cur, tsz);
+    plan->IW = ntt_i_carve(&cur, tsz);
+
+    // calculate roots of unity
+    uint64_t w = gl_pow(GL_G, (NTT_GL_P - 1) / N);
+    uint64_t w_inv = gl_pow(w, NTT_GL_P - 2);
+
+    uint64_t Wi = 1, Wi_inv = 1;
+
+    // caculate twiddle factors w^i (mod p) for the last stage
+    int64_t i, m2 = N / 2;
+    for (i = 0; i < m2; ++i) {
+        plan->W[m2 + i] = Wi;
+        plan->IW[m2 + i] = Wi_inv;
+        Wi = ntt_i_gl_mul(Wi, w);
+        Wi_inv = ntt_i_gl_mul(Wi_inv, w_inv);
+    }
+
+    // every previous stage uses every other twiddle of the one after it
+    for (m2 = N / 4; m2 >= 1; m2 /= 2) {
+        for (i = 0; i < m2; ++i) {
+            plan->W[m2 + i] = plan->W[2 * m2 + 2 * i];
+            plan->IW[m2 + i] = plan->IW[2 * m2 + 2 * i];
+        }
+    }
+    plan->W[0] = plan->IW[0] = 1;
+}
+
+// free the plan's tables
+void ntt_plan_gl_free(ntt_plan_gl_t* plan) {
+    ntt_i_free(plan->mem);
+    *plan = NTT_PLAN_GL_EMPTY;
+}
+
+// the number of threads a single transform of this plan is split across
+static int gl_threads(ntt_plan_gl_t* plan) {
+    return plan->N >= NTT_BFLY_MT_MIN_N && plan->nthreads > 1 ? plan->nthreads : 1;
+}
+
+// run a single DIT (U, V) -> (U + wV, U - wV) or DIF (if 'dif') (U, V) -> (U + V, w(U - V))
+//   stage on the butterflies i in [i0, i1) of each block (see 'dit_range' in 'bfly_plan.c')
+static void gl_range(ntt_plan_gl_t* plan, uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, bool inv, bool dif) {
+    uint64_t* W = inv ? plan->IW : plan->W;
+    int64_t i, k;
+
+    for (k = 0; k < N; k += 2 * m2) {
+        i = i0;
+        if (i == 0 && i1 > 0) {
+            // w^0 = 1, so there's nothing to multiply (which is the whole first DIT stage)
+            // NOTE: with more threads than butterflies, some get an empty range [0, 0), and
+            //   mustn't do this one too
+            uint64_t u = x[k], v = x[k + m2];
+            x[k] = ntt_i_gl_add(u, v);
+            x[k + m2] = ntt_i_gl_sub(u, v);
+            i = 1;
+        }
+        for (; i < i1; ++i) {
+            uint64_t u = x[k + i], v = x[k + i + m2];
+            if (dif) {
+                x[k + i] = ntt_i_gl_add(u, v);
+                x[k + i + m2] = ntt_i_gl_mul(ntt_i_gl_sub(u, v), W[m2 + i]);
+            } else {
+                v = ntt_i_gl_mul(v, W[m2 + i]);
+                x[k + i] = ntt_i_gl_add(u, v);
+                x[k + i + m2] = ntt_i_gl_sub(u, v);
+            }
+        }
+    }
+}
+
+// run a single stage over all of 'x', split across the plan's threads (see 'bfly_pass' in
+//   'bfly_plan.c')
+static void gl_pass(ntt_plan_gl_t* plan, uint64_t* x, int64_t m2, bool inv, bool dif) {
+    int64_t N = plan->N;
+    int nt = gl_threads(plan);
+
+    if (nt == 1) {
+        gl_range(plan, x, N, m2, 0, m2, inv, dif);
+        return;
+    }
+
+    int64_t bs = 2 * m2, nb = N / bs;
+
+    int t;
+    if (nb >= nt) {
+        #pragma omp parallel for num_threads(nt)
+        for (t = 0; t < nt; ++t) {
+            int64_t b0 = nb * t / nt, b1 = nb * (t + 1) / nt;
+            gl_range(plan, x + b0 * bs, (b1 - b0) * bs, m2, 0, m2, inv, dif);
+        }
+    } else {
+        #pragma omp parallel for num_threads(nt)
+        for (t = 0; t < nt; ++t) {
+            gl_range(plan, x, N, m2, m2 * t / nt, m2 * (t + 1) / nt, inv, dif);
+        }
+    }
+}
+
+// run all the DIT stages in place on 'x' (which is in bit reversed order)
+static void gl_dit(ntt_plan_gl_t* plan, uint64_t* x, bool inv) {
+    int64_t m2;
+    for (m2 = 1; m2 < plan->N; m2 *= 2) {
+        gl_pass(plan, x, m2, inv, false);
+    }
+}
+
+// run all the DIF stages in place on 'x' (which is in natural order), leaving the result in
+//   bit reversed order
+static void gl_dif(ntt_plan_gl_t* plan, uint64_t* x, bool inv) {
+    int64_t m2;
+    for (m2 = plan->N / 2; m2 >= 1; m2 /= 2) {
+        gl_pass(plan, x, m2, inv, true);
+    }
+}
+
+// copy 'inp' to 'out', reducing every element into [0, p)
+static void copy_reduce_gl(ntt_plan_gl_t* plan, uint64_t* out, uint64_t* inp) {
+    int nt = gl_threads(plan);
+
+    int64_t i;
+    #pragma omp parallel for num_threads(nt) if(nt > 1)
+    for (i = 0; i < plan->N; ++i) {
+        out[i] = inp[i] >= NTT_GL_P ? inp[i] - NTT_GL_P : inp[i];
+    }
+}
+
+// multiply by the corrective factor N^-1
+static void scale_N_inv_gl(ntt_plan_gl_t* plan, uint64_t* x) {
+    int nt = gl_threads(plan);
+
+    int64_t i;
+    #pragma omp parallel for num_threads(nt) if(nt > 1)
+    for (i = 0; i < plan->N; ++i) {
+        x[i] = ntt_i_gl_mul(x[i], plan->N_inv);
+    }
+}
+
+// Do forward NTT:
+// out = NTT(inp)
+void ntt_plan_gl_NTT(ntt_plan_gl_t* plan, uint64_t* inp, uint64_t* out) {
+    copy_reduce_gl(plan, out, inp);
+    shuffle_bitrev_gl(out, plan->N);
+    gl_dit(plan, out, false);
+}
+
+// Do inverse NTT (INTT):
+// out = INTT(inp)
+void ntt_plan_gl_INTT(ntt_plan_gl_t* plan, uint64_t* inp, uint64_t* out) {
+    copy_reduce_gl(plan, out, inp);
+    shuffle_bitrev_gl(out, plan->N);
+    gl_dit(plan, out, true);
+    scale_N_inv_gl(plan, out);
+}
+
+// Do forward NTT, leaving the result in bit reversed order:
+// out = bitrev(NTT(inp))
+void ntt_plan_gl_NTT_bitrev(ntt_plan_gl_t* plan, uint64_t* inp, uint64_t* out) {
+    copy_reduce_gl(plan, out, inp);
+    gl_dif(plan, out, false);
+}
+
+// Do inverse NTT (INTT), taking the input in bit reversed order:
+// out = INTT(bitrev(inp))
+void ntt_plan_gl_INTT_bitrev(ntt_plan_gl_t* plan, uint64_t* inp, uint64_t* out) {
+    copy_reduce_gl(plan, out, inp);
+    gl_dit(plan, out, true);
+    scale_N_inv_gl(plan, out);
+}
@@ -1,138 +1,856 @@
 /* multer.c - multiplier utility class */
 
 #include "ntt.h"
+#include "ntt-impl.h"
 
+// the transform size to use for inputs of 'N' elements, which is the smallest of 2^k, 3 * 2^k
+//   and 5 * 2^k that is >= N
+// NOTE: the butterfly plans can do any 2^a * 3^b * 5^c, but the radix-3/5 stages are scalar,
+//   so sizes with more than one of them are slower than just going up to the next power of 2
+static int64_t multer_size(int64_t N) {
+    int64_t n2 = 1;
+    while (n2 < N) n2 *= 2;
 
-void ntt_multer_init(ntt_multer_t* multer, int64_t N) {
-    multer->N = N;
+    // 3 * 2^k and 5 * 2^k are between n2/2 and n2, so try them with the power of 2 below n2
+    int64_t best = n2;
+    if (n2 >= 4 && 3 * (n2 / 4) >= N) best = 3 * (n2 / 4);
+    if (n2 >= 8 && 5 * (n2 / 8) >= N && 5 * (n2 / 8) < best) best = 5 * (n2 / 8);
+    return best;
+}
+
+// allocate 'n' of each of the temporary buffers (of 'multer->N' elements), the primes, and
+//   the CRT tables, from a single aligned arena
+// NOTE: the 'nttB' buffers are only allocated once they're needed (see 'multer_alloc_B'),
+//   since squaring never uses them. Everything after the forward transforms happens in
+//   place in 'nttA' (or 'nttA32'), so there are no others
+static void multer_alloc(ntt_multer_t* multer, int n) {
+    size_t psz = sizeof(*multer->nttA) * n, csz = sizeof(*multer->CRT_inv) * n * n, bsz = sizeof(**multer->nttA) * multer->N;
+    size_t qsz = sizeof(*multer->primes) * n, p32sz = sizeof(*multer->nttA32) * n, b32sz = sizeof(**multer->nttA32) * multer->N;
+    bool use_32 = multer->plans32 != NULL;
+    multer->mem = ntt_i_alloc(2 * ntt_i_aligned(psz) + 2 * ntt_i_aligned(p32sz) + ntt_i_aligned(qsz) + 2 * ntt_i_aligned(csz) + n * ntt_i_aligned(bsz) + (use_32 ? n * ntt_i_aligned(b32sz) : 0));
+
+    char* cur = multer->mem;
+    multer->nttA = ntt_i_carve(&cur, psz);
+    multer->nttB = ntt_i_carve(&cur, psz);
+    multer->nttA32 = ntt_i_carve(&cur, p32sz);
+    multer->nttB32 = ntt_i_carve(&cur, p32sz);
+    multer->primes = ntt_i_carve(&cur, qsz);
+    multer->CRT_inv = ntt_i_carve(&cur, csz);
+    multer->CRT_inv_shoup = ntt_i_carve(&cur, csz);
+
+    int i;
+    for (i = 0; i < n; ++i) {
+        multer->nttA[i] = ntt_i_carve(&cur, bsz);
+        multer->nttA32[i] = use_32 ? ntt_i_carve(&cur, b32sz) : NULL;
+        multer->nttB[i] = NULL;
+        multer->nttB32[i] = NULL;
+    }
+}
+
+// allocate the 'nttB' buffers (from their own arena), if they haven't been already
+static void multer_alloc_B(ntt_multer_t* multer) {
+    if (multer->mem_B != NULL) return;
+
+    int i, n = multer->use_gl ? 1 : multer->n_plans;
+    bool use_32 = multer->plans32 != NULL;
+    size_t bsz = use_32 ? sizeof(**multer->nttB32) * multer->N : sizeof(**multer->nttB) * multer->N;
+    multer->mem_B = ntt_i_alloc(n * ntt_i_aligned(bsz));
+
+    char* cur = multer->mem_B;
+    for (i = 0; i < n; ++i) {
+        if (use_32) {
+            multer->nttB32[i] = ntt_i_carve(&cur, bsz);
+        } else {
+            multer->nttB[i] = ntt_i_carve(&cur, bsz);
+        }
+    }
+}
 
-    multer->n_plans = 0;
-    multer->plans = NULL;
+// the most primes that a multiplier will use
+#define MULTER_MAX_PRIMES 8
 
-    // maximum word to be handled
-    int64_t max_word = 256;
+// the most 64 bit words that a coefficient (< the product of the primes, which are < 2^62),
+//   plus a carry, can need
+#define MULTER_MAX_WORDS (MULTER_MAX_PRIMES + 1)
 
-    //printf("N: %lli\n", N);
+// the number of coefficients that each thread does at once in the CRT
+#define MULTER_CRT_BLOCK 1024
 
-    int64_t prod_p = 1;
+// the number of transform sizes (for 2^j times the small operand, j > 0, as well as the full
+//   product) that 'ntt_multer_init_bits' tries
+#define MULTER_CHUNK_SIZES 6
 
-    int64_t min_p = (max_word * max_word) * N;
-    //printf("%lli\n", min_p);
+// the smallest transform to do chunks with, since below this, the overhead of each chunk
+//   (the CRT setup, threading, and so on) outweighs the transforms
+#define MULTER_CHUNK_MIN_N 4096
 
+// the limb widths that 'ntt_multer_init_bits' chooses from
+static const int multer_limb_bits[] = { 8, 16, 24, 32 };
 
-    /*
-    // current prime
-    int64_t p = N * (min_p / N) + 1;
-    
-    // generate new 'p'
-    while (!ntt_isprime(p)) {
-        p += N;
+// the sizes of primes that the multiplier chooses from, which are the limits of the AVX2 and
+//   AVX-512 kernels, the IFMA kernels, and the lazy scalar kernels
+static const int multer_prime_bits[] = { 30, 50, 62 };
+
+// the largest primes that the kernels for 'isa' can use
+static int multer_isa_bits(ntt_isa_t isa) {
+    /**/ if (isa == NTT_ISA_AVX512IFMA) return 50;
+    else if (isa >= NTT_ISA_AVX2) return 30;
+    return 62;
+}
+
+// return whether 'p' is one of the 'n' primes in 'ps'
+static bool multer_has_prime(int64_t* ps, int n, int64_t p) {
+    int i;
+    for (i = 0; i < n; ++i) {
+        if (ps[i] == p) return true;
     }
+    return false;
+}
 
-    // add to the plans
-    multer->plans = realloc(multer->plans, sizeof(*multer->plans) * ++multer->n_plans);
-    multer->plans[multer->n_plans - 1] = NTT_PLAN_BFLY_EMPTY;
-    ntt_plan_bfly_init(&multer->plans[multer->n_plans - 1], N, p);
-    // record product
-    prod_p *= p;
-    p += N;
+// pick the largest primes p = Nk + 1 below 2^'bits' until their product is greater than
+//   'bound', and store them in 'ps'
+// Returns the number of primes, or 0 if it would take more than MULTER_MAX_PRIMES
+static int multer_pick_primes(int64_t N, unsigned __int128 bound, int bits, int64_t* ps) {
+    unsigned __int128 prod = 1;
+    int n = 0, skip = 0, i;
 
-    */
+    // first, use the primes from './configure --ntt-primes' (if they have N'th roots of unity),
+    //   since they have faster kernels (but only for the smallest size, otherwise there would
+    //   just be more primes)
+    if (bits == multer_prime_bits[0]) {
+        for (i = 0; ntt_i_fixed[i].p != 0 && prod <= bound; ++i) {
+            int64_t fp = ntt_i_fixed[i].p;
+            if ((fp - 1) % N != 0 || fp >= (1LL << bits)) continue;
+            if (n >= MULTER_MAX_PRIMES) return 0;
+            ps[n++] = fp;
+            prod *= fp;
+        }
+    }
 
-    int64_t p = N + 1;
+    // the largest Nk + 1 below 2^bits, to search down from once the table runs out
+    int64_t p = (((1LL << bits) - 2) / N) * N + 1;
 
-    // TODO: Figure out how to select different primes for transforms
-    while (prod_p < min_p) {
-        // generate new 'p'
-        while (!ntt_isprime(p)) {
-            p += N;
+    while (prod <= bound) {
+        // take the next prime from the built-in table, or, once that runs out, search for one
+        int64_t q = ntt_prime_lookup(N, bits, skip++, NULL);
+        if (q == 0) {
+            while (p > N && (!ntt_isprime(p) || multer_has_prime(ps, n, p))) p -= N;
+            if (p <= N) return 0;
+            q = p;
+            p -= N;
+        } else if (multer_has_prime(ps, n, q)) {
+            continue;
         }
 
-        // add to the plans
-        multer->plans = realloc(multer->plans, sizeof(*multer->plans) * ++multer->n_plans);
-        multer->plans[multer->n_plans - 1] = NTT_PLAN_BFLY_EMPTY;
-        ntt_plan_bfly_init(&multer->plans[multer->n_plans - 1], N, p);
-        // record product
-        prod_p *= p;
-        p += N;
+        if (n >= MULTER_MAX_PRIMES) return 0;
+        ps[n++] = q;
 
+        // once the product would overflow, it's certainly more than 'bound' (< 2^128)
+        prod = prod > ~(unsigned __int128)0 / q ? ~(unsigned __int128)0 : prod * q;
     }
 
-    multer->prod_p = prod_p;
+    return n;
+}
+
+// pick the fewest primes for a transform of 'N' points (with primes of at most 'max_bits'
+//   bits) whose product is greater than 'bound'
+// Returns the number of primes (stored in 'ps'), or 0 if there's no such set
+static int multer_choose_primes(int64_t N, unsigned __int128 bound, int max_bits, int64_t* ps) {
+    int64_t cur[MULTER_MAX_PRIMES];
+    int n = 0, i, j;
 
-    // allocate temporary buffers
-    multer->nttA = malloc(sizeof(*multer->nttA) * multer->n_plans);
-    multer->nttB = malloc(sizeof(*multer->nttB) * multer->n_plans);
-    multer->nttC = malloc(sizeof(*multer->nttC) * multer->n_plans);
-    multer->C = malloc(sizeof(*multer->C) * multer->n_plans);
+    for (i = 0; i < (int)(sizeof(multer_prime_bits) / sizeof(*multer_prime_bits)); ++i) {
+        if (multer_prime_bits[i] > max_bits) break;
+
+        // on a tie, the smaller primes are kept, since they may have faster pointwise kernels
+        int cn = multer_pick_primes(N, bound, multer_prime_bits[i], cur);
+        if (cn > 0 && (n == 0 || cn < n)) {
+            n = cn;
+            for (j = 0; j < n; ++j) ps[j] = cur[j];
+        }
+    }
+
+    return n;
+}
+
+// set up the multiplier for transforms of 'N' points, with the 'n' primes in 'ps' (using the
+//   kernels for 'isa', at best)
+static void multer_setup(ntt_multer_t* multer, int64_t N, int64_t* ps, int n, ntt_isa_t isa) {
     int64_t i;
+
+    multer->N = N;
+    multer->isa = isa;
+    multer->use_gl = false;
+    multer->n_plans = n;
+
+    // the 32 bit plans only do powers of 2, with primes below 2^31, but they move half as much
+    //   memory, so they're used whenever they can be
+    bool use_32 = (N & (N - 1)) == 0;
+    for (i = 0; i < n; ++i) {
+        if (ps[i] >= (1LL << 31)) use_32 = false;
+    }
+
+    // large transforms are split across all the threads, one plan at a time, since there
+    //   are usually fewer plans than threads
+    int nt = N >= NTT_BFLY_MT_MIN_N ? ntt_num_threads() : 1;
+
+    // outputs are always fully reduced, so the faster lazy path is safe for all of these
+    if (use_32) {
+        multer->plans32 = malloc(sizeof(*multer->plans32) * n);
+        for (i = 0; i < n; ++i) {
+            multer->plans32[i] = NTT_PLAN_BFLY32_EMPTY;
+            ntt_plan_bfly32_init(&multer->plans32[i], N, ps[i]);
+            multer->plans32[i].lazy = true;
+            multer->plans32[i].nthreads = nt;
+            if (multer->plans32[i].isa > isa) multer->plans32[i].isa = isa;
+        }
+    } else {
+        multer->plans = malloc(sizeof(*multer->plans) * n);
+        for (i = 0; i < n; ++i) {
+            multer->plans[i] = NTT_PLAN_BFLY_EMPTY;
+            ntt_plan_bfly_init(&multer->plans[i], N, ps[i]);
+            multer->plans[i].lazy = true;
+            multer->plans[i].nthreads = nt;
+            if (multer->plans[i].isa > isa) multer->plans[i].isa = isa;
+        }
+    }
+
+    unsigned __int128 prod_p = 1;
+    for (i = 0; i < n; ++i) {
+        if (prod_p <= INT64_MAX) prod_p *= ps[i];
+    }
+
+    multer->prod_p = prod_p <= INT64_MAX ? (int64_t)prod_p : 0;
+
+    // allocate temporary buffers
+    multer_alloc(multer, n);
+    for (i = 0; i < n; ++i) multer->primes[i] = ps[i];
+
+    // now, calculate the inverses for Garner's algorithm (see 'multer_garner')
+    int64_t j;
+    for (i = 0; i < n; ++i) {
+        for (j = 0; j < i; ++j) {
+            int64_t pi = ps[i], inv = ntt_modinv(ps[j] % pi, pi);
+            multer->CRT_inv[i * n + j] = inv;
+            multer->CRT_inv_shoup[i * n + j] = ntt_i_shoup(inv, pi);
+        }
+    }
+}
+
+void ntt_multer_init(ntt_multer_t* multer, int64_t N) {
+    ntt_multer_free(multer);
+
+    // round up to a size that the butterfly plans are fast at
+    N = multer_size(N);
+
+    // the words are (at most) 8 bits, so no coefficient is more than 256^2 * N
+    multer->limb_bits = 8;
+    multer->nA = multer->nB = N;
+
+    ntt_isa_t isa = ntt_isa_detect();
+    int64_t ps[MULTER_MAX_PRIMES];
+    int n = multer_choose_primes(N, (unsigned __int128)(256 * 256) * N, multer_isa_bits(isa), ps);
+
+    multer_setup(multer, N, ps, n, isa);
+}
+
+void ntt_multer_init_bits(ntt_multer_t* multer, int64_t bitsA, int64_t bitsB, ntt_isa_t target) {
+    int64_t best_N = 0, best_cost = 0, N;
+    int64_t best_ps[MULTER_MAX_PRIMES], ps[MULTER_MAX_PRIMES];
+    int best_n = 0, best_l = 0, n, l, i, j;
+
+    ntt_multer_free(multer);
+
+    if (bitsA < 1) bitsA = 1;
+    if (bitsB < 1) bitsB = 1;
+
+    // try each limb width, and keep the one with the cheapest transforms (wider limbs give
+    //   smaller transforms, but may need more primes)
+    for (i = 0; i < (int)(sizeof(multer_limb_bits) / sizeof(*multer_limb_bits)); ++i) {
+        l = multer_limb_bits[i];
+        int64_t nA = (bitsA + l - 1) / l, nB = (bitsB + l - 1) / l;
+
+        int64_t nS = nA < nB ? nA : nB, nL = nA < nB ? nB : nA;
+
+        // the largest coefficient of the product, (2^l - 1)^2 * min(nA, nB) (which is the
+        //   same whether or not the product is done in chunks)
+        unsigned __int128 lmax = (1ULL << l) - 1;
+
+        // the product has (at most) nA + nB limbs, so try a transform that fits all of it,
+        //   and (when the operands are unbalanced) smaller ones that fit the small operand
+        //   and a chunk of the large one (see 'multer_chunked_limbs')
+        for (j = 0; j < MULTER_CHUNK_SIZES; ++j) {
+            int64_t full = multer_size(nA + nB);
+            N = j == 0 ? full : multer_size((nS << j) > MULTER_CHUNK_MIN_N ? nS << j : MULTER_CHUNK_MIN_N);
+            if (j > 0 && N >= full) break;
+
+            n = multer_choose_primes(N, lmax * lmax * nS, multer_isa_bits(target), ps);
+            if (n == 0) continue;
+
+            // the cost of the transforms, n * N * log2(N) each, where the full product needs
+            //   3 per prime, and the chunked one needs 2 per chunk, plus 1 for the small operand
+            int64_t lgN = 0;
+            while ((1LL << lgN) < N) lgN++;
+            int64_t n_tf = j == 0 ? 3 : 1 + 2 * ((nL + (N - nS)) / (N - nS + 1));
+            int64_t cost = n_tf * n * N * lgN;
+
+            if (best_n == 0 || cost < best_cost) {
+                best_cost = cost;
+                best_N = N;
+                best_n = n;
+                best_l = l;
+                memcpy(best_ps, ps, sizeof(*ps) * n);
+            }
+        }
+    }
+
+    // if no limb width and size had a set of primes (which only happens for sizes far past
+    //   the prime table), there's nothing to set up
+    assert(best_n > 0);
+
+    multer->limb_bits = best_l;
+    multer->nA = (bitsA + best_l - 1) / best_l;
+    multer->nB = (bitsB + best_l - 1) / best_l;
+
+    multer_setup(multer, best_N, best_ps, best_n, target);
+}
+
+
+void ntt_multer_init_gl(ntt_multer_t* multer, int64_t N) {
+    ntt_multer_free(multer);
+
+    // the Goldilocks plans only do powers of 2
+    int64_t n2 = 1;
+    while (n2 < N) n2 *= 2;
+    multer->N = n2;
+
+    multer->prod_p = 0;
+    multer->isa = ntt_isa_detect();
+    multer->limb_bits = 8;
+    multer->nA = multer->nB = n2;
+
+    // a single prime is enough, since the largest coefficient (256^2 * N) is well below it
+    multer->use_gl = true;
+    ntt_plan_gl_init(&multer->gl, n2);
+    if (n2 >= NTT_BFLY_MT_MIN_N) multer->gl.nthreads = ntt_num_threads();
+
+    multer_alloc(multer, 1);
+}
+
+void ntt_multer_free(ntt_multer_t* multer) {
+    int i;
     for (i = 0; i < multer->n_plans; ++i) {
-        multer->nttA[i] = malloc(sizeof(**multer->nttA) * N);
-        multer->nttB[i] = malloc(sizeof(**multer->nttB) * N);
-        multer->nttC[i] = malloc(sizeof(**multer->nttC) * N);
-        multer->C[i] = malloc(sizeof(**multer->C) * N);
+        if (multer->plans != NULL) ntt_plan_bfly_free(&multer->plans[i]);
+        if (multer->plans32 != NULL) ntt_plan_bfly32_free(&multer->plans32[i]);
+    }
+    free(multer->plans);
+    free(multer->plans32);
+    ntt_plan_gl_free(&multer->gl);
+
+    ntt_i_free(multer->mem);
+    ntt_i_free(multer->mem_B);
+    *multer = NTT_MULTER_EMPTY;
+}
+
+// whether the transforms are split across threads themselves (see 'multer_setup')
+static bool multer_mt(ntt_multer_t* multer) {
+    return multer->plans32 != NULL ? multer->plans32[0].nthreads > 1 : multer->plans[0].nthreads > 1;
+}
+
+// the forward transforms of 'X' (of 'nX' elements) for each of the primes, into 'out->ntt[i]'
+//   (or 'out->ntt32[i]', for the 32 bit plans)
+// NOTE: the pointwise product doesn't care about the order of the transforms, so we
+//   use the bit reversed ones, and never have to do a permutation
+static void multer_forward(ntt_multer_t* multer, int64_t* X, int64_t nX, ntt_multer_prep_t out) {
+    int64_t i;
+
+    if (multer->use_gl) {
+        // the buffers hold values mod the Goldilocks prime, which need all 64 bits (and these
+        //   transforms aren't pruned, so pad with 0's). Every 'int64_t' is already below it,
+        //   except the negative ones, which wrap around to 2^64 - |x| (so add p to those)
+        uint64_t* t = (uint64_t*)out.ntt[0];
+        for (i = 0; i < multer->N; ++i) {
+            t[i] = i >= nX ? 0 : X[i] < 0 ? (uint64_t)X[i] + NTT_GL_P : (uint64_t)X[i];
+        }
+        ntt_plan_gl_NTT_bitrev(&multer->gl, t, t);
+        return;
     }
 
-    // now, calculate CRT bits
-    multer->CRT_p = malloc(sizeof(*multer->CRT_p) * multer->n_plans);
+    // if the transforms are already multithreaded, do the plans one at a time
+    bool mt = multer_mt(multer);
+
+    if (multer->plans32 != NULL) {
+        // the 32 bit transforms aren't pruned, so pad with 0's
+        #pragma omp parallel for if(!mt)
+        for (i = 0; i < multer->n_plans; ++i) {
+            uint32_t* t = out.ntt32[i];
+            int64_t j, p = multer->primes[i];
+            for (j = 0; j < multer->N; ++j) {
+                t[j] = j < nX ? ntt_i_reduce(X[j], p) : 0;
+            }
+            ntt_plan_bfly32_NTT_bitrev(&multer->plans32[i], t, t);
+        }
+        return;
+    }
 
+    #pragma omp parallel for if(!mt)
     for (i = 0; i < multer->n_plans; ++i) {
-        // compute the product of all 'p' except for the current
-        multer->CRT_p[i].Ni = prod_p / multer->plans[i].p;
-        // compute the inverse of Ni (mod p)
-        multer->CRT_p[i].d = ntt_modinv(multer->CRT_p[i].Ni, multer->plans[i].p);
+        ntt_plan_bfly_NTT_bitrev_pruned(&multer->plans[i], X, nX, out.ntt[i]);
     }
+}
 
+// the transforms of A (in 'nttA', or 'nttA32'), like a prepared operand
+static ntt_multer_prep_t multer_ntt_A(ntt_multer_t* multer) {
+    return (ntt_multer_prep_t){ .N = multer->N, .n_ntt = multer->n_plans, .ntt = multer->nttA, .ntt32 = multer->nttA32, .mem = NULL };
 }
 
+// the transforms of B (in 'nttB', or 'nttB32'), like a prepared operand
+static ntt_multer_prep_t multer_ntt_B(ntt_multer_t* multer) {
+    return (ntt_multer_prep_t){ .N = multer->N, .n_ntt = multer->n_plans, .ntt = multer->nttB, .ntt32 = multer->nttB32, .mem = NULL };
+}
 
+// the transforms of 'B' to multiply 'A' by, which are done into 'multer->nttB', unless it's
+//   a squaring (A == B), where the transforms of 'A' (in 'multer->nttA', which 'multer_conv'
+//   fills in before it uses them) are used instead
+static ntt_multer_prep_t multer_forward_B(ntt_multer_t* multer, int64_t* A, int64_t nA, int64_t* B, int64_t nB) {
+    if (A == B && nA == nB) return multer_ntt_A(multer);
 
-void ntt_multer_mult(ntt_multer_t* multer, int64_t* A, int64_t* B, int64_t* C) {
+    multer_alloc_B(multer);
+    multer_forward(multer, B, nB, multer_ntt_B(multer));
+    return multer_ntt_B(multer);
+}
+
+// the convolution of 'A' with the operand whose transforms are 'nttB' (see 'multer_forward'),
+//   which leaves the first 'nC' coefficients (mod the i'th prime) in 'multer->nttA[i]'
+// The pointwise product and inverse transform are done in place, so after the forward
+//   transform of 'A', nothing else is written (and the CRT reads from 'nttA' too)
+static void multer_conv(ntt_multer_t* multer, int64_t* A, int64_t nA, ntt_multer_prep_t nttB, int64_t nC) {
     int64_t i;
 
-    // apply forward NTT's on all plans
-    #pragma omp parallel for
-    for (i = 0; i < multer->n_plans; ++i) {
-        ntt_plan_bfly_NTT(&multer->plans[i], A, multer->nttA[i]);
-        ntt_plan_bfly_NTT(&multer->plans[i], B, multer->nttB[i]);
+    multer_forward(multer, A, nA, multer_ntt_A(multer));
+
+    if (multer->use_gl) {
+        uint64_t* tA = (uint64_t*)multer->nttA[0], *tB = (uint64_t*)nttB.ntt[0];
+        for (i = 0; i < multer->N; ++i) {
+            tA[i] = ntt_i_gl_mul(tA[i], tB[i]);
+        }
+
+        // the coefficients are exact (no CRT required)
+        ntt_plan_gl_INTT_bitrev(&multer->gl, tA, tA);
+        return;
     }
 
-    // convolve via pointwise multiplication
+    // if the transforms are already multithreaded, do the plans one at a time
+    bool mt = multer_mt(multer);
+
+    if (multer->plans32 != NULL) {
+        // the same, but on the 32 bit transforms, whose first 'nC' coefficients are widened
+        //   into 'nttA' at the end
+        #pragma omp parallel for
+        for (i = 0; i < multer->n_plans; ++i) {
+            uint32_t* tA = multer->nttA32[i], *tB = nttB.ntt32[i];
+            uint64_t p = multer->primes[i];
+
+            // the products are < p^2 < 2^62, so a Barrett reduction with floor(2^64 / p) is
+            //   off by at most p (and there's no division)
+            uint64_t m = ~0ULL / p;
+            int64_t j;
+            for (j = 0; j < multer->N; ++j) {
+                uint64_t x = (uint64_t)tA[j] * tB[j];
+                x -= ntt_i_mulhi(x, m) * p;
+                tA[j] = x >= p ? x - p : x;
+            }
+        }
+
+        #pragma omp parallel for if(!mt)
+        for (i = 0; i < multer->n_plans; ++i) {
+            uint32_t* tA = multer->nttA32[i];
+            int64_t j;
+            ntt_plan_bfly32_INTT_bitrev(&multer->plans32[i], tA, tA);
+            for (j = 0; j < nC; ++j) {
+                multer->nttA[i][j] = tA[j];
+            }
+        }
+        return;
+    }
+
+    // convolve via pointwise multiplication (in place)
     #pragma omp parallel for
     for (i = 0; i < multer->n_plans; ++i) {
-        int64_t j;
-        for (j = 0; j < multer->N; ++j) {
-            multer->nttC[i][j] = (multer->nttA[i][j] * multer->nttB[i][j]) % multer->plans[i].p;
+        int64_t j, *tA = multer->nttA[i];
+        if (multer->plans[i].fixed >= 0) {
+            // the modulus is a constant in these, so there's no division
+            ntt_i_fixed[multer->plans[i].fixed].mulmod(tA, tA, nttB.ntt[i], multer->N);
+        } else if (multer->primes[i] < (1LL << 31)) {
+            for (j = 0; j < multer->N; ++j) {
+                tA[j] = (tA[j] * nttB.ntt[i][j]) % multer->primes[i];
+            }
+        } else {
+            // the product doesn't fit in 64 bits
+            for (j = 0; j < multer->N; ++j) {
+                tA[j] = ntt_modmul(tA[j], nttB.ntt[i][j], multer->primes[i]);
+            }
         }
     }
 
-    // inverse NTT to find value in 'C'
-    #pragma omp parallel for
+    // inverse NTT (in place) to find the coefficients
+    #pragma omp parallel for if(!mt)
     for (i = 0; i < multer->n_plans; ++i) {
-        ntt_plan_bfly_INTT(&multer->plans[i], multer->nttC[i], multer->C[i]);
+        ntt_plan_bfly_INTT_bitrev_pruned(&multer->plans[i], multer->nttA[i], multer->nttA[i], nC);
+    }
+}
+
+// Garner's algorithm, which replaces the residues c_i = C (mod p_i) in 'multer->nttA[i]' (for
+//   the coefficients in [c0, c1)) with the mixed radix digits v_i of C, where
+//   C = v_0 + p_0 * (v_1 + p_1 * (v_2 + ...)), and 0 <= v_i < p_i
+// Each digit is v_i = (...((c_i - v_0) * p_0^-1 - v_1) * p_1^-1 - ...) (mod p_i), so every step
+//   is a single Shoup multiply by one of the precomputed inverses (and there's no division)
+static void multer_garner(ntt_multer_t* multer, int64_t c0, int64_t c1) {
+    int n = multer->n_plans, i, j;
+    int64_t c;
+
+    for (i = 1; i < n; ++i) {
+        uint64_t p = multer->primes[i];
+        uint64_t* Ci = (uint64_t*)multer->nttA[i];
+
+        // a multiple of 'p' that is at least 2^62 (so, more than any v_j), which keeps
+        //   'Ci[c] - v_j' positive (and it's still < 2^64, since p < 2^62)
+        uint64_t M = p * (((1ULL << 62) + p - 1) / p);
+
+        for (j = 0; j < i; ++j) {
+            uint64_t* Cj = (uint64_t*)multer->nttA[j];
+            uint64_t w = multer->CRT_inv[i * n + j], wp = multer->CRT_inv_shoup[i * n + j];
+            for (c = c0; c < c1; ++c) {
+                Ci[c] = ntt_i_mulshoup(Ci[c] + M - Cj[c], w, wp, p);
+            }
+        }
+    }
+}
+
+// the number of 64 bit words that a coefficient, plus a carry, can need
+static int multer_words(ntt_multer_t* multer) {
+    int i, bits = 2;
+    if (multer->use_gl) {
+        bits += 64;
+    } else {
+        for (i = 0; i < multer->n_plans; ++i) {
+            uint64_t p = multer->primes[i];
+            while (p > 0) {
+                bits++;
+                p >>= 1;
+            }
+        }
+    }
+    return (bits + 63) / 64;
+}
+
+// set 'x' (of 'nw' words, least significant first) to the coefficient 'c', from its mixed
+//   radix digits (see 'multer_garner'), as C = (...(v_(n-1) * p_(n-2) + v_(n-2)) ...) * p_0 + v_0
+static void multer_coef(ntt_multer_t* multer, int64_t c, int nw, uint64_t* x) {
+    int i, k, n = multer->use_gl ? 1 : multer->n_plans;
+
+    x[0] = multer->nttA[n - 1][c];
+    for (k = 1; k < nw; ++k) x[k] = 0;
+
+    for (i = n - 2; i >= 0; --i) {
+        uint64_t p = multer->primes[i];
+        unsigned __int128 t = (uint64_t)multer->nttA[i][c];
+        for (k = 0; k < nw; ++k) {
+            t += (unsigned __int128)x[k] * p;
+            x[k] = (uint64_t)t;
+            t >>= 64;
+        }
+    }
+}
+
+// x += y (of 'nw' words)
+static void multer_add_words(uint64_t* x, const uint64_t* y, int nw) {
+    unsigned __int128 t = 0;
+    int k;
+    for (k = 0; k < nw; ++k) {
+        t += (unsigned __int128)x[k] + y[k];
+        x[k] = (uint64_t)t;
+        t >>= 64;
+    }
+}
+
+// take the lowest 'bits' bits of 'x' (of 'nw' words), and shift the rest down (0 < bits < 64)
+static uint64_t multer_pop_bits(uint64_t* x, int bits, int nw) {
+    uint64_t r = x[0] & ((1ULL << bits) - 1);
+    int k;
+    for (k = 0; k < nw - 1; ++k) {
+        x[k] = (x[k] >> bits) | (x[k + 1] << (64 - bits));
+    }
+    x[nw - 1] >>= bits;
+    return r;
+}
+
+// return whether 'x' (of 'nw' words) is zero
+static bool multer_is_zero(const uint64_t* x, int nw) {
+    int k;
+    for (k = 0; k < nw; ++k) {
+        if (x[k] != 0) return false;
     }
+    return true;
+}
+
+// write the coefficients [c0, c1) (c1 <= N) from 'multer_conv' to 'C' (so, 'C[0]' is
+//   coefficient 'c0')
+static void multer_out_coefs(ntt_multer_t* multer, int64_t* C, int64_t c0, int64_t c1) {
+    int64_t i;
 
     // now, combine to get the actual 'digits'
-    if (multer->n_plans == 1) {
+    if (multer->use_gl || multer->n_plans == 1) {
         // just copy it over (no CRT required)
-        memcpy(C, multer->C[0], sizeof(*C) * multer->N);
-    } else {
-        // Now, we have found 'C' modulo all the 'p' from plans, so we must combine via CRT
-        for (i = 0; i < multer->N; ++i) {
-            int64_t C_i = 0;
+        memcpy(C, multer->nttA[0] + c0, sizeof(*C) * (c1 - c0));
+        return;
+    }
 
-            // sum c_i * N_i * d_i
-            int64_t j;
-            for (j = 0; j < multer->n_plans; ++j) {
-                C_i += ntt_modmul(multer->CRT_p[j].Ni, ntt_modmul(multer->CRT_p[j].d, multer->C[j][i], multer->prod_p), multer->prod_p);
-                C_i %= multer->prod_p;
+    // Now, we have found 'C' modulo all the 'p' from plans, so we must combine via CRT (the
+    //   coefficients fit in an 'int64_t', so the mixed radix sum can just wrap around 2^64)
+    #pragma omp parallel for
+    for (i = c0; i < c1; i += MULTER_CRT_BLOCK) {
+        int64_t c, b1 = i + MULTER_CRT_BLOCK < c1 ? i + MULTER_CRT_BLOCK : c1;
+        int j;
+        multer_garner(multer, i, b1);
+        for (c = i; c < b1; ++c) {
+            uint64_t x = multer->nttA[multer->n_plans - 1][c];
+            for (j = multer->n_plans - 2; j >= 0; --j) {
+                x = x * multer->primes[j] + multer->nttA[j][c];
             }
+            C[c - c0] = x;
+        }
+    }
+}
+
+// write the first 'nC' limbs of the product from 'multer_conv' (which computed the first
+//   'nK' <= N coefficients, and the rest are 0) to 'C'
+static void multer_out_limbs(ntt_multer_t* multer, int64_t* C, int64_t nC, int64_t nK) {
+    int nw = multer_words(multer), L = multer->limb_bits;
+    bool garner = !multer->use_gl && multer->n_plans > 1;
+
+    // split 'C' into a part per thread, which each do the CRT and propagate their own carries
+    //   (in blocks, so the digits are still in cache), and then add each part's outgoing
+    //   carry into the next one
+    int t, nt = nC >= 4 * MULTER_CRT_BLOCK ? ntt_num_threads() : 1;
+    uint64_t (*carries)[MULTER_MAX_WORDS] = malloc(sizeof(*carries) * nt);
 
-            // now, we have the unique solution mod (prod_p), which
-            //   should be large enough for any 'digit'
-            if (C_i < 0) C_i += multer->prod_p;
-            C[i] = C_i;
+    #pragma omp parallel for num_threads(nt) if(nt > 1)
+    for (t = 0; t < nt; ++t) {
+        int64_t c, b, b1, c0 = nC * t / nt, c1 = nC * (t + 1) / nt;
+        uint64_t x[MULTER_MAX_WORDS], carry[MULTER_MAX_WORDS] = { 0 };
+        int k;
+
+        for (b = c0; b < c1; b = b1) {
+            b1 = b + MULTER_CRT_BLOCK < c1 ? b + MULTER_CRT_BLOCK : c1;
+            if (garner && b < nK) multer_garner(multer, b, b1 < nK ? b1 : nK);
+
+            for (c = b; c < b1; ++c) {
+                if (c < nK) {
+                    multer_coef(multer, c, nw, x);
+                } else {
+                    for (k = 0; k < nw; ++k) x[k] = 0;
+                }
+                multer_add_words(x, carry, nw);
+                C[c] = multer_pop_bits(x, L, nw);
+                memcpy(carry, x, sizeof(*x) * nw);
+            }
         }
+
+        memcpy(carries[t], carry, sizeof(*carry) * nw);
     }
+
+    // the carry out of part 't' goes into the start of part 't + 1', and ripples through it
+    //   (usually only for a few limbs), and whatever comes out of the end goes into the next
+    uint64_t x[MULTER_MAX_WORDS], carry[MULTER_MAX_WORDS] = { 0 };
+    for (t = 0; t < nt - 1; ++t) {
+        int64_t c = nC * (t + 1) / nt, c1 = nC * (t + 2) / nt;
+        int k;
+
+        multer_add_words(carry, carries[t], nw);
+        for (; c < c1 && !multer_is_zero(carry, nw); ++c) {
+            x[0] = C[c];
+            for (k = 1; k < nw; ++k) x[k] = 0;
+            multer_add_words(x, carry, nw);
+            C[c] = multer_pop_bits(x, L, nw);
+            memcpy(carry, x, sizeof(*x) * nw);
+        }
+    }
+
+    free(carries);
+}
+
+void ntt_multer_mult(ntt_multer_t* multer, int64_t* A, int64_t* B, int64_t* C) {
+    ntt_multer_mult_pruned(multer, A, multer->N, B, multer->N, C, multer->N);
+}
+
+void ntt_multer_sqr(ntt_multer_t* multer, int64_t* A, int64_t nA, int64_t* C, int64_t nC) {
+    ntt_multer_mult_pruned(multer, A, nA, A, nA, C, nC);
+}
+
+void ntt_multer_mult_pruned(ntt_multer_t* multer, int64_t* A, int64_t nA, int64_t* B, int64_t nB, int64_t* C, int64_t nC) {
+    assert(nC <= multer->N);
+
+    multer_conv(multer, A, nA, multer_forward_B(multer, A, nA, B, nB), nC);
+    multer_out_coefs(multer, C, 0, nC);
+}
+
+// set 'C' (of 'nC' limbs) to 'L * S', when the product is too large for a single transform,
+//   by transforming 'S' once and sliding it across 'L' in chunks, adding each chunk's product
+//   into 'C' (overlap-add)
+// Each chunk of K = N - nS + 1 limbs of 'L' has a product of K + nS - 1 <= N coefficients, so
+//   there's no wrap around, and only the last nS limbs overlap the next one. So, the memory
+//   needed only depends on N (which is a few times 'nS'), and the time is linear in 'nL'
+// NOTE: if 'S' doesn't fit either (nS >= N), it's split into pieces of N / 2 limbs, which are
+//   each slid across 'L' like that (so this is quadratic, but still correct)
+static void multer_chunked_limbs(ntt_multer_t* multer, int64_t* L, int64_t nL, int64_t* S, int64_t nS, int64_t* C, int64_t nC) {
+    int64_t nP = nS < multer->N ? nS : (multer->N > 1 ? multer->N / 2 : 1), K = multer->N - nP + 1;
+    int64_t s0, off, hw = 0, i;
+    int64_t mask = (1LL << multer->limb_bits) - 1;
+
+    multer_alloc_B(multer);
+
+    // each chunk's product (in limbs), before it's added in
+    int64_t* T = malloc(sizeof(*T) * (K + nP));
+
+    for (s0 = 0; s0 < nS && s0 < nC; s0 += nP) {
+        int64_t ns = nS - s0 < nP ? nS - s0 : nP;
+        multer_forward(multer, S + s0, ns, multer_ntt_B(multer));
+
+        for (off = s0; off - s0 < nL && off < nC; off += K) {
+            int64_t len = nL - (off - s0) < K ? nL - (off - s0) : K;
+
+            // the chunk's product has (at most) len + ns limbs, from len + ns - 1 coefficients
+            int64_t nT = len + ns < nC - off ? len + ns : nC - off;
+            int64_t nK = len + ns - 1 < nT ? len + ns - 1 : nT;
+
+            multer_conv(multer, L + (off - s0), len, multer_ntt_B(multer), nK);
+            multer_out_limbs(multer, T, nT, nK);
+
+            // C += T * 2^(off * limb_bits), where everything in C at or above 'hw' is still
+            //   unset, and the carry ripples on through whatever an earlier piece wrote
+            int64_t carry = 0;
+            for (i = 0; i < nT || (carry != 0 && off + i < nC); ++i) {
+                int64_t t = (i < nT ? T[i] : 0) + carry + (off + i < hw ? C[off + i] : 0);
+                C[off + i] = t & mask;
+                carry = t >> multer->limb_bits;
+            }
+            if (off + i > hw) hw = off + i;
+        }
+    }
+
+    // the product has nL + nS limbs, and the rest are 0
+    for (i = hw; i < nC; ++i) C[i] = 0;
+
+    free(T);
 }
 
+// set 'C' to the coefficients [lo, hi) of 'A * B', with a single cyclic convolution of 'N'
+//   points, which wraps the coefficients k >= N around onto k - N
+// Only A[i] with lo - nB < i < hi (and the same for 'B') touch the window, so the rest are
+//   dropped first. Then, with S coefficients in the (trimmed) product, every coefficient in
+//   the window is exact as long as N >= hi (so, nothing in it wraps), and N >= S - lo (so,
+//   nothing that wraps lands in it), which is where the savings come from, since the
+//   coefficients below 'lo' can be garbage
+static void multer_window(ntt_multer_t* multer, int64_t* A, int64_t nA, int64_t* B, int64_t nB, int64_t lo, int64_t hi, int64_t* C) {
+    int64_t a0 = lo - nB + 1 > 0 ? lo - nB + 1 : 0, b0 = lo - nA + 1 > 0 ? lo - nA + 1 : 0;
+    int64_t a1 = nA < hi ? nA : hi, b1 = nB < hi ? nB : hi, i;
+
+    // the coefficients past the end of the product are just 0
+    int64_t nS = nA + nB - 1;
+    for (i = (nS > lo ? nS : lo); i < hi; ++i) C[i - lo] = 0;
+    if (hi > nS) hi = nS;
+    if (hi <= lo) return;
+
+    A += a0;
+    B += b0;
+    lo -= a0 + b0;
+    hi -= a0 + b0;
+
+    // the window has to fit in a single transform (see the NOTEs in 'ntt.h'), otherwise
+    //   'multer_conv' would run past the end of the buffers
+    assert(hi <= multer->N && (a1 - a0) + (b1 - b0) - 1 - lo <= multer->N);
+
+    multer_conv(multer, A, a1 - a0, multer_forward_B(multer, A, a1 - a0, B, b1 - b0), hi);
+    multer_out_coefs(multer, C, lo, hi);
+}
+
+void ntt_multer_mulmid(ntt_multer_t* multer, int64_t* A, int64_t nA, int64_t* B, int64_t nB, int64_t* C) {
+    multer_window(multer, A, nA, B, nB, nB - 1, nA, C);
+}
+
+void ntt_multer_mulhigh(ntt_multer_t* multer, int64_t* A, int64_t nA, int64_t* B, int64_t nB, int64_t* C, int64_t nC) {
+    assert(nC <= nA + nB - 1);
+    multer_window(multer, A, nA, B, nB, nA + nB - 1 - nC, nA + nB - 1, C);
+}
+
+void ntt_multer_mult_limbs(ntt_multer_t* multer, int64_t* A, int64_t nA, int64_t* B, int64_t nB, int64_t* C, int64_t nC) {
+    // the limbs past 'nC' can't change the result, so drop them
+    if (nA > nC) nA = nC;
+    if (nB > nC) nB = nC;
+
+    // if the product doesn't fit in a single transform, it would wrap around onto the low
+    //   limbs, so do it in chunks of the larger operand
+    if (nA + nB - 1 > multer->N) {
+        if (nA < nB) {
+            multer_chunked_limbs(multer, B, nB, A, nA, C, nC);
+        } else {
+            multer_chunked_limbs(multer, A, nA, B, nB, C, nC);
+        }
+        return;
+    }
+
+    // only the first 'N' coefficients are non-zero (the rest of 'C' is just carries)
+    int64_t nK = nC < multer->N ? nC : multer->N;
+
+    multer_conv(multer, A, nA, multer_forward_B(multer, A, nA, B, nB), nK);
+    multer_out_limbs(multer, C, nC, nK);
+}
+
+void ntt_multer_prepare(ntt_multer_t* multer, int64_t* B, int64_t nB, ntt_multer_prep_t* prep) {
+    int i, n = multer->use_gl ? 1 : multer->n_plans;
+
+    // (re)allocate the transforms (from a single aligned arena), if it was prepared for a
+    //   different multiplier
+    bool use_32 = multer->plans32 != NULL;
+    if (prep->N != multer->N || prep->n_ntt != n || (prep->ntt32 != NULL) != use_32) {
+        size_t psz = use_32 ? sizeof(*prep->ntt32) * n : sizeof(*prep->ntt) * n;
+        size_t bsz = use_32 ? sizeof(**prep->ntt32) * multer->N : sizeof(**prep->ntt) * multer->N;
+        ntt_i_free(prep->mem);
+        prep->mem = ntt_i_alloc(ntt_i_aligned(psz) + n * ntt_i_aligned(bsz));
+
+        char* cur = prep->mem;
+        if (use_32) {
+            prep->ntt = NULL;
+            prep->ntt32 = ntt_i_carve(&cur, psz);
+            for (i = 0; i < n; ++i) prep->ntt32[i] = ntt_i_carve(&cur, bsz);
+        } else {
+            prep->ntt = ntt_i_carve(&cur, psz);
+            prep->ntt32 = NULL;
+            for (i = 0; i < n; ++i) prep->ntt[i] = ntt_i_carve(&cur, bsz);
+        }
+        prep->N = multer->N;
+        prep->n_ntt = n;
+    }
+
+    multer_forward(multer, B, nB, *prep);
+}
+
+void ntt_multer_prep_free(ntt_multer_prep_t* prep) {
+    ntt_i_free(prep->mem);
+    *prep = NTT_MULTER_PREP_EMPTY;
+}
+
+void ntt_multer_mult_prepared(ntt_multer_t* multer, int64_t* A, int64_t nA, ntt_multer_prep_t* prepB, int64_t* C, int64_t nC) {
+    assert(nC <= multer->N);
+
+    multer_conv(multer, A, nA, *prepB, nC);
+    multer_out_coefs(multer, C, 0, nC);
+}
+
+void ntt_multer_mult_prepared_limbs(ntt_multer_t* multer, int64_t* A, int64_t nA, ntt_multer_prep_t* prepB, int64_t* C, int64_t nC) {
+    int64_t nK = nC < multer->N ? nC : multer->N;
+
+    multer_conv(multer, A, nA, *prepB, nK);
+    multer_out_limbs(multer, C, nC, nK);
+}
@@ -0,0 +1,227 @@
+/* ntt-impl.h - internal helpers shared by the library sources (not installed)
+ *
+ * These are 'static inline' so that the butterfly kernels can use them without
+ *   any call overhead
+ *
+ */
+
+#pragma once
+#ifndef NTT_IMPL_H__
+#define NTT_IMPL_H__
+
+#include "ntt.h"
+
+#include <assert.h>
+
+
+/* modular arithmetic helpers */
+
+// Calculate the high 64 bits of the full 128 bit product a*b
+static inline uint64_t ntt_i_mulhi(uint64_t a, uint64_t b) {
+    return (uint64_t)(((unsigned __int128)a * b) >> 64);
+}
+
+// Calculate the Shoup precomputed quotient for a constant 'w' (mod p):
+//   w' = floor(w * 2^64 / p)
+// NOTE: requires 0 <= w < p < 2^63
+static inline uint64_t ntt_i_shoup(uint64_t w, uint64_t p) {
+    return (uint64_t)((((unsigned __int128)w) << 64) / p);
+}
+
+// Calculate x*w (mod p), but only reduced into the range [0, 2p)
+// NOTE: 'wp' must be ntt_i_shoup(w, p); 'x' may be any 64 bit value
+static inline uint64_t ntt_i_mulshoup_lazy(uint64_t x, uint64_t w, uint64_t wp, uint64_t p) {
+    // estimate of the quotient (which is either exact, or 1 too small)
+    uint64_t q = ntt_i_mulhi(x, wp);
+    // this wraps around correctly, since the true result is < 2p
+    return x * w - q * p;
+}
+
+// Calculate x*w (mod p), fully reduced into the range [0, p)
+static inline uint64_t ntt_i_mulshoup(uint64_t x, uint64_t w, uint64_t wp, uint64_t p) {
+    uint64_t r = ntt_i_mulshoup_lazy(x, w, wp, p);
+    return r >= p ? r - p : r;
+}
+
+// Calculate the 32 bit Shoup precomputed quotient for a constant 'w' (mod p):
+//   w' = floor(w * 2^32 / p)
+// NOTE: requires 0 <= w < p < 2^31
+static inline uint32_t ntt_i_shoup32(uint32_t w, uint32_t p) {
+    return (uint32_t)(((uint64_t)w << 32) / p);
+}
+
+// Calculate x*w (mod p), but only reduced into the range [0, 2p), with a single 32x32->64
+//   bit multiply for the quotient
+// NOTE: 'wp' must be ntt_i_shoup32(w, p); 'x' may be any 32 bit value
+static inline uint32_t ntt_i_mulshoup32_lazy(uint32_t x, uint32_t w, uint32_t wp, uint32_t p) {
+    uint32_t q = (uint32_t)(((uint64_t)x * wp) >> 32);
+    return x * w - q * p;
+}
+
+// Calculate x*w (mod p), fully reduced into the range [0, p)
+static inline uint32_t ntt_i_mulshoup32(uint32_t x, uint32_t w, uint32_t wp, uint32_t p) {
+    uint32_t r = ntt_i_mulshoup32_lazy(x, w, wp, p);
+    return r >= p ? r - p : r;
+}
+
+
+// Reduce a (signed) input into [0, p)
+static inline int64_t ntt_i_reduce(int64_t x, int64_t p) {
+    // only divide for inputs out of range, which are rare in practice
+    if ((uint64_t)x >= (uint64_t)p) {
+        x %= p;
+        if (x < 0) x += p;
+    }
+    return x;
+}
+
+/* Goldilocks prime arithmetic (see 'gl_plan.c') */
+
+// 2^64 (mod NTT_GL_P), i.e. 2^32 - 1
+#define NTT_I_GL_EPS 0xFFFFFFFFULL
+
+// Reduce a 128 bit 'x' mod NTT_GL_P, into [0, NTT_GL_P)
+// NOTE: the carries and borrows are random, so they're applied with masks instead of branches
+static inline uint64_t ntt_i_gl_reduce(unsigned __int128 x) {
+    uint64_t lo = (uint64_t)x, hi = (uint64_t)(x >> 64);
+    uint64_t hh = hi >> 32, hl = hi & NTT_I_GL_EPS;
+
+    // x = lo + hl * 2^64 + hh * 2^96 = lo + hl * (2^32 - 1) - hh
+    uint64_t t = lo - hh;
+    // (on a borrow, 't' is 2^64 too large, which is EPS too large mod p)
+    t -= NTT_I_GL_EPS & -(uint64_t)(lo < hh);
+
+    uint64_t u = (hl << 32) - hl;
+    uint64_t r = t + u;
+    // (on a carry, 'r' is 2^64 too small)
+    r += NTT_I_GL_EPS & -(uint64_t)(r < u);
+
+    return r - (NTT_GL_P & -(uint64_t)(r >= NTT_GL_P));
+}
+
+// Calculate a + b (mod NTT_GL_P), for a, b in [0, NTT_GL_P)
+static inline uint64_t ntt_i_gl_add(uint64_t a, uint64_t b) {
+    uint64_t r = a + b;
+    r += NTT_I_GL_EPS & -(uint64_t)(r < a);
+    return r - (NTT_GL_P & -(uint64_t)(r >= NTT_GL_P));
+}
+
+// Calculate a - b (mod NTT_GL_P), for a, b in [0, NTT_GL_P)
+static inline uint64_t ntt_i_gl_sub(uint64_t a, uint64_t b) {
+    uint64_t r = a - b;
+    return r - (NTT_I_GL_EPS & -(uint64_t)(a < b));
+}
+
+// Calculate a * b (mod NTT_GL_P)
+static inline uint64_t ntt_i_gl_mul(uint64_t a, uint64_t b) {
+    return ntt_i_gl_reduce((unsigned __int128)a * b);
+}
+
+
+/* memory (see 'ntt.c') */
+
+// the alignment of everything from 'ntt_i_alloc' (a cache line, and an AVX-512 vector)
+#define NTT_I_ALIGN 64
+
+// allocations at least this large (2MB, one huge page) are mapped with the mode from
+//   'ntt_set_hugepages', and smaller ones just come from the heap
+#define NTT_I_HUGE_MIN ((size_t)1 << 21)
+
+// Allocate 'sz' bytes, aligned to NTT_I_ALIGN
+void* ntt_i_alloc(size_t sz);
+
+// Free memory from 'ntt_i_alloc' (or NULL)
+void ntt_i_free(void* ptr);
+
+// Round 'sz' bytes up to a multiple of NTT_I_ALIGN, so that all the tables that are carved
+//   out of a single allocation (see 'ntt_i_carve') stay aligned
+static inline size_t ntt_i_aligned(size_t sz) {
+    return (sz + NTT_I_ALIGN - 1) & ~(size_t)(NTT_I_ALIGN - 1);
+}
+
+// Take the next 'sz' bytes of an arena, where '*cur' is the first unused byte
+static inline void* ntt_i_carve(char** cur, size_t sz) {
+    void* r = *cur;
+    *cur += ntt_i_aligned(sz);
+    return r;
+}
+
+
+/* kernels specialized for fixed primes (see 'bfly_fixed.c') */
+
+// a prime given to './configure --ntt-primes', with the kernels that have it baked in as a
+//   constant
+typedef struct {
+
+    // the prime, and a primitive root of it (computed by './configure')
+    uint64_t p;
+    uint64_t g;
+
+    // pointwise product: out[i] = a[i] * b[i] (mod p), for a[i], b[i] in [0, p)
+    void (*mulmod)(int64_t* out, const int64_t* a, const int64_t* b, int64_t n);
+
+} ntt_i_fixed_t;
+
+// all the fixed primes, ending with an entry with p = 0
+extern const ntt_i_fixed_t ntt_i_fixed[];
+
+// Return the index of 'p' in 'ntt_i_fixed', or -1 if there are no kernels for it
+int ntt_i_fixed_find(uint64_t p);
+
+
+/* SIMD kernels (see 'bfly_simd.c') */
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define NTT_I_X86
+#endif
+
+// Return the number of 64 bit lanes the kernels for 'isa' process at once, or
+//   0 if they can't handle the modulus 'p'
+int ntt_i_isa_width(ntt_isa_t isa, uint64_t p);
+
+#ifdef NTT_I_X86
+
+// Run a single radix-2 DIT stage of half-size 'm2' over 'x' (of length N), using the
+//   stage-contiguous twiddles W[m2 + i], but only for the butterflies with i in [i0, i1)
+//   of each block. 'i0' and 'i1' must be multiples of the vector width
+// If 'lazy', values are kept in [0, 4p), otherwise [0, p)
+void ntt_i_dit_stage_avx2(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy);
+void ntt_i_dit_stage_avx512(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy);
+void ntt_i_dit_stage_avx512ifma(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy);
+
+// Run a single radix-2 DIF stage, with the same conventions as the DIT stages
+// If 'lazy', values are kept in [0, 2p), otherwise [0, p)
+void ntt_i_dif_stage_avx2(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy);
+void ntt_i_dif_stage_avx512(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy);
+void ntt_i_dif_stage_avx512ifma(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy);
+
+// Run a radix-4 pass, fusing the stages of half-size 'm2' and '2*m2'
+void ntt_i_dit4_stage_avx2(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy);
+void ntt_i_dit4_stage_avx512(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy);
+void ntt_i_dit4_stage_avx512ifma(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy);
+void ntt_i_dif4_stage_avx2(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy);
+void ntt_i_dif4_stage_avx512(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy);
+void ntt_i_dif4_stage_avx512ifma(uint64_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const int64_t* W, const uint64_t* W_shoup, uint64_t p, bool lazy);
+
+
+/* 32 bit SIMD kernels (see 'bfly32_simd.c') */
+
+// Return the number of 32 bit lanes the kernels for 'isa' process at once, or
+//   0 if they can't be used
+int ntt_i_isa_width32(ntt_isa_t isa);
+
+// The same as the 64 bit kernels, but on 32 bit coefficients, with the 32 bit twiddles and
+//   Shoup quotients from 'ntt_plan_bfly32_t' (so p < 2^31, and lazy requires p < 2^30)
+void ntt_i_dit_stage32_avx2(uint32_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const uint32_t* W, const uint32_t* W_shoup, uint32_t p, bool lazy);
+void ntt_i_dit_stage32_avx512(uint32_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const uint32_t* W, const uint32_t* W_shoup, uint32_t p, bool lazy);
+void ntt_i_dif_stage32_avx2(uint32_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const uint32_t* W, const uint32_t* W_shoup, uint32_t p, bool lazy);
+void ntt_i_dif_stage32_avx512(uint32_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const uint32_t* W, const uint32_t* W_shoup, uint32_t p, bool lazy);
+void ntt_i_dit4_stage32_avx2(uint32_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const uint32_t* W, const uint32_t* W_shoup, uint32_t p, bool lazy);
+void ntt_i_dit4_stage32_avx512(uint32_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const uint32_t* W, const uint32_t* W_shoup, uint32_t p, bool lazy);
+void ntt_i_dif4_stage32_avx2(uint32_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const uint32_t* W, const uint32_t* W_shoup, uint32_t p, bool lazy);
+void ntt_i_dif4_stage32_avx512(uint32_t* x, int64_t N, int64_t m2, int64_t i0, int64_t i1, const uint32_t* W, const uint32_t* W_shoup, uint32_t p, bool lazy);
+
+#endif
+
+
+#endif /* NTT_IMPL_H__ */
@@ -1,6 +1,99 @@
+// for MAP_ANONYMOUS and 'posix_memalign', which strict C99 hides
+#define _GNU_SOURCE
 
 #include "ntt.h"
+#include "ntt-impl.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 
 
+// Return the number of threads available for parallel work
+int ntt_num_threads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+
+// how the large allocations are done (see 'ntt_set_hugepages')
+static ntt_hugepages_t ntt_hugepages = NTT_HUGEPAGES_MADVISE;
+
+void ntt_set_hugepages(ntt_hugepages_t mode) {
+    ntt_hugepages = mode;
+}
+
+// the header just before everything from 'ntt_i_alloc' (in its own NTT_I_ALIGN bytes), which
+//   records how to free it
+typedef struct {
+
+    // the start and size of the underlying allocation
+    void* base;
+    size_t size;
+
+    // whether it came from 'mmap' (otherwise, it's from 'posix_memalign')
+    bool mapped;
+
+} ntt_i_block_t;
+
+void* ntt_i_alloc(size_t sz) {
+    void* base = NULL;
+    size_t size = sz + NTT_I_ALIGN;
+    bool mapped = false;
+
+#ifdef __linux__
+    if (ntt_hugepages != NTT_HUGEPAGES_OFF && sz >= NTT_I_HUGE_MIN) {
+#ifdef MAP_HUGETLB
+        if (ntt_hugepages == NTT_HUGEPAGES_HUGETLB) {
+            // these have to be a whole number of huge pages
+            size_t hsize = (size + NTT_I_HUGE_MIN - 1) & ~(NTT_I_HUGE_MIN - 1);
+            base = mmap(NULL, hsize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (base == MAP_FAILED) {
+                base = NULL;
+            } else {
+                size = hsize;
+            }
+        }
+#endif
+        if (base == NULL) {
+            base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base == MAP_FAILED) {
+                base = NULL;
+            } else {
+#ifdef MADV_HUGEPAGE
+                madvise(base, size, MADV_HUGEPAGE);
+#endif
+            }
+        }
+        mapped = base != NULL;
+    }
+#endif
+
+    if (base == NULL && posix_memalign(&base, NTT_I_ALIGN, size) != 0) return NULL;
+
+    ntt_i_block_t* hdr = base;
+    hdr->base = base;
+    hdr->size = size;
+    hdr->mapped = mapped;
+    return (char*)base + NTT_I_ALIGN;
+}
+
+void ntt_i_free(void* ptr) {
+    if (ptr == NULL) return;
+
+    ntt_i_block_t* hdr = (ntt_i_block_t*)((char*)ptr - NTT_I_ALIGN);
+#ifdef __linux__
+    if (hdr->mapped) {
+        munmap(hdr->base, hdr->size);
+        return;
+    }
+#endif
+    free(hdr->base);
+}
@@ -0,0 +1,942 @@
+/* check.c - checks of the library's plans and multipliers, against naive transforms and
+ *   schoolbook products
+ *
+ * Run with 'make check' (which also runs './test_mul.sh'). Prints every failure, and exits
+ *   with the number of them
+ *
+ */
+
+#include "ntt.h"
+
+
+// the number of checks that failed
+static int n_fail = 0;
+
+// record a failure (with a printf-style message) if 'cond' isn't true
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        n_fail++; \
+        printf("FAIL: " __VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+
+/* helpers */
+
+// a random value in [0, m)
+static int64_t rand_mod(int64_t m) {
+    uint64_t r = ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+    return (int64_t)(r % (uint64_t)m);
+}
+
+// fill 'x' with 'N' random values in [0, m)
+static void rand_fill(int64_t* x, int64_t N, int64_t m) {
+    int64_t i;
+    for (i = 0; i < N; ++i) x[i] = rand_mod(m);
+}
+
+// return whether the first 'N' elements of 'x' and 'y' are the same
+static bool same(int64_t* x, int64_t* y, int64_t N) {
+    return memcmp(x, y, sizeof(*x) * N) == 0;
+}
+
+// the root of unity that a transform used, which is NTT(e_1)[1] (where e_1 = [0, 1, 0, ...])
+static int64_t root_of(int64_t* e1_ntt, int64_t N) {
+    return N > 1 ? e1_ntt[1] : 1;
+}
+
+// check that 'y' is the NTT of 'x' (mod 'p'), with the root of unity 'w', at a sample of
+//   (at most ~64) outputs, by evaluating the sum directly
+static bool naive_ntt_ok(int64_t* x, int64_t* y, int64_t N, int64_t w, int64_t p) {
+    if (ntt_modpow(w, N, p) != 1) return false;
+    if (N > 1 && ntt_modpow(w, N / 2, p) == 1 && N % 2 == 0) return false;
+
+    int64_t k, i, step = N <= 64 ? 1 : N / 61 + 1;
+    for (k = 0; k < N; k += step) {
+        uint64_t s = 0, wk = ntt_modpow(w, k, p), wi = 1;
+        for (i = 0; i < N; ++i) {
+            s = (s + ntt_modmul(x[i], wi, p)) % p;
+            wi = ntt_modmul(wi, wk, p);
+        }
+        if ((int64_t)s != y[k]) return false;
+    }
+    return true;
+}
+
+// set 'C' to the first 'nC' coefficients of the product of 'A' and 'B' (or, if 'N' > 0, of
+//   their cyclic convolution of 'N' points), the schoolbook way
+static void schoolbook(int64_t* A, int64_t nA, int64_t* B, int64_t nB, int64_t* C, int64_t nC, int64_t N) {
+    int64_t i, j;
+    for (i = 0; i < nC; ++i) C[i] = 0;
+    for (i = 0; i < nA; ++i) {
+        for (j = 0; j < nB; ++j) {
+            int64_t k = N > 0 ? (i + j) % N : i + j;
+            if (k < nC) C[k] += A[i] * B[j];
+        }
+    }
+}
+
+// set 'C' to the first 'nC' limbs of the product of the integers 'A' and 'B' (in limbs of
+//   'bits' bits, least significant first), the schoolbook way
+static void schoolbook_limbs(int64_t* A, int64_t nA, int64_t* B, int64_t nB, int64_t* C, int64_t nC, int bits) {
+    unsigned __int128* S = calloc(nC > 0 ? nC : 1, sizeof(*S));
+    int64_t i, j;
+    for (i = 0; i < nA && i < nC; ++i) {
+        for (j = 0; j < nB && i + j < nC; ++j) {
+            S[i + j] += (unsigned __int128)(uint64_t)A[i] * (uint64_t)B[j];
+        }
+    }
+
+    unsigned __int128 carry = 0;
+    for (i = 0; i < nC; ++i) {
+        carry += S[i];
+        C[i] = (int64_t)(carry & ((1ULL << bits) - 1));
+        carry >>= bits;
+    }
+    free(S);
+}
+
+
+/* butterfly plans */
+
+// check a butterfly plan of 'N' points (mod 'p', or 0 to pick one) against a naive transform,
+//   with the given kernel options, and its inverse and bit reversed transforms against that
+static void check_bfly(int64_t N, int64_t p, bool lazy, ntt_isa_t isa, int radix, int nthreads) {
+    ntt_plan_bfly_t plan = NTT_PLAN_BFLY_EMPTY;
+    ntt_plan_bfly_init(&plan, N, p);
+    plan.lazy = lazy;
+    if (isa < plan.isa) plan.isa = isa;
+    plan.radix = radix;
+    plan.nthreads = nthreads;
+    p = plan.p;
+
+    int64_t* x = malloc(sizeof(*x) * N), *y = malloc(sizeof(*y) * N), *z = malloc(sizeof(*z) * N);
+    int64_t i;
+
+    for (i = 0; i < N; ++i) z[i] = i == 1;
+    ntt_plan_bfly_NTT(&plan, z, z);
+    int64_t w = root_of(z, N);
+
+    rand_fill(x, N, p);
+    ntt_plan_bfly_NTT(&plan, x, y);
+    CHECK(naive_ntt_ok(x, y, N, w, p), "bfly NTT N=%lld p=%lld lazy=%d isa=%d radix=%d nthreads=%d", (long long)N, (long long)p, lazy, isa, radix, nthreads);
+
+    ntt_plan_bfly_INTT(&plan, y, z);
+    CHECK(same(x, z, N), "bfly INTT N=%lld p=%lld lazy=%d isa=%d radix=%d nthreads=%d", (long long)N, (long long)p, lazy, isa, radix, nthreads);
+
+    // the bit reversed transforms are permutations of the natural ones (or, for the mixed
+    //   radix sizes, 'perm' gives the order)
+    int64_t* b = malloc(sizeof(*b) * N);
+    int lg = 0;
+    while ((1LL << lg) < N) lg++;
+
+    ntt_plan_bfly_NTT_bitrev(&plan, x, b);
+    bool ok = true;
+    for (i = 0; i < N; ++i) {
+        int64_t r = 0, t;
+        if (plan.perm != NULL) {
+            r = plan.perm[i];
+        } else {
+            for (t = 0; t < lg; ++t) {
+                if ((i >> t) & 1) r |= 1LL << (lg - 1 - t);
+            }
+        }
+        if (b[i] != y[r]) ok = false;
+    }
+    CHECK(ok, "bfly NTT_bitrev N=%lld p=%lld lazy=%d isa=%d radix=%d nthreads=%d", (long long)N, (long long)p, lazy, isa, radix, nthreads);
+
+    ntt_plan_bfly_INTT_bitrev(&plan, b, z);
+    CHECK(same(x, z, N), "bfly INTT_bitrev N=%lld p=%lld lazy=%d isa=%d radix=%d nthreads=%d", (long long)N, (long long)p, lazy, isa, radix, nthreads);
+
+    free(x);
+    free(y);
+    free(z);
+    free(b);
+    ntt_plan_bfly_free(&plan);
+}
+
+// check the batched transforms against single ones, for 'count' transforms of 'N' points,
+//   stored with a stride of 'stride' between elements
+static void check_bfly_batch(int64_t N, int64_t count, int64_t stride) {
+    ntt_plan_bfly_t plan = NTT_PLAN_BFLY_EMPTY;
+    ntt_plan_bfly_init(&plan, N, 0);
+
+    // element 'j' of transform 'v' is at v * dist + j * stride (so, interleaved if stride > 1)
+    int64_t dist = stride > 1 ? 1 : N, size = N * count;
+    int64_t* x = malloc(sizeof(*x) * size), *y = malloc(sizeof(*y) * size), *z = malloc(sizeof(*z) * size);
+    int64_t* r = malloc(sizeof(*r) * N), *t = malloc(sizeof(*t) * N);
+    int64_t v, j;
+
+    rand_fill(x, size, plan.p);
+    ntt_plan_bfly_NTT_batch(&plan, count, x, stride, dist, y, stride, dist);
+
+    bool ok = true;
+    for (v = 0; v < count; ++v) {
+        for (j = 0; j < N; ++j) t[j] = x[v * dist + j * stride];
+        ntt_plan_bfly_NTT(&plan, t, r);
+        for (j = 0; j < N; ++j) {
+            if (y[v * dist + j * stride] != r[j]) ok = false;
+        }
+    }
+    CHECK(ok, "bfly NTT_batch N=%lld count=%lld stride=%lld", (long long)N, (long long)count, (long long)stride);
+
+    // and in place
+    memcpy(z, y, sizeof(*z) * size);
+    ntt_plan_bfly_INTT_batch(&plan, count, z, stride, dist, z, stride, dist);
+    CHECK(same(x, z, size), "bfly INTT_batch N=%lld count=%lld stride=%lld", (long long)N, (long long)count, (long long)stride);
+
+    free(x);
+    free(y);
+    free(z);
+    free(r);
+    free(t);
+    ntt_plan_bfly_free(&plan);
+}
+
+static void check_bflys() {
+    int64_t Ns[] = { 1, 2, 4, 8, 16, 64, 512, 1024, 4096 };
+    ntt_isa_t isas[] = { NTT_ISA_SCALAR, ntt_isa_detect() };
+    int i, j, lazy, radix;
+
+    for (i = 0; i < (int)(sizeof(Ns) / sizeof(*Ns)); ++i) {
+        for (j = 0; j < 2; ++j) {
+            for (lazy = 0; lazy < 2; ++lazy) {
+                for (radix = 2; radix <= 4; radix += 2) {
+                    check_bfly(Ns[i], 0, lazy, isas[j], radix, 1);
+                }
+            }
+        }
+    }
+
+    // primes too large for the SIMD kernels (and for the lazy kernels)
+    check_bfly(1024, ntt_prime_lookup(1024, 50, 0, NULL), true, ntt_isa_detect(), 4, 1);
+    check_bfly(1024, ntt_prime_lookup(1024, 62, 0, NULL), true, ntt_isa_detect(), 4, 1);
+
+    // large enough to be split across threads (with more threads than some of the stages
+    //   have butterflies)
+    check_bfly(NTT_BFLY_MT_MIN_N, 0, true, ntt_isa_detect(), 4, 3);
+    check_bfly(2 * NTT_BFLY_MT_MIN_N, 0, false, NTT_ISA_SCALAR, 2, 8);
+    check_bfly(NTT_BFLY_MT_MIN_N, 0, true, ntt_isa_detect(), 4, 200);
+
+    check_bfly_batch(16, 13, 1);
+    check_bfly_batch(64, 8, 1);
+    check_bfly_batch(1024, 3, 1);
+    check_bfly_batch(8, 21, 21);
+    check_bfly_batch(4096, 2, 1);
+}
+
+// the mixed radix (2/3/5) sizes
+static void check_bflys_mixed() {
+    int64_t Ns[] = { 3, 5, 6, 9, 10, 12, 15, 25, 45, 60, 81, 360, 3 * 1024, 5 * 512, 3 * 5 * 256 };
+    ntt_isa_t isas[] = { NTT_ISA_SCALAR, ntt_isa_detect() };
+    int i, j, lazy;
+
+    for (i = 0; i < (int)(sizeof(Ns) / sizeof(*Ns)); ++i) {
+        CHECK(ntt_smooth_size(Ns[i]) == Ns[i], "ntt_smooth_size(%lld)", (long long)Ns[i]);
+        for (j = 0; j < 2; ++j) {
+            for (lazy = 0; lazy < 2; ++lazy) {
+                check_bfly(Ns[i], 0, lazy, isas[j], 4, 1);
+            }
+        }
+    }
+
+    CHECK(ntt_smooth_size(7) == 8 && ntt_smooth_size(11) == 12 && ntt_smooth_size(1025) == 1080, "ntt_smooth_size");
+    check_bfly(3 * NTT_BFLY_MT_MIN_N, 0, true, ntt_isa_detect(), 4, 3);
+
+    // the batches of these are done one transform at a time
+    check_bfly_batch(12, 7, 1);
+    check_bfly_batch(15, 5, 5);
+    check_bfly_batch(360, 9, 1);
+}
+
+
+/* 32 bit plans */
+
+// copy 'N' 32 bit values to 64 bit ones (reduced mod 'p')
+static void widen(uint32_t* x, int64_t* y, int64_t N, int64_t p) {
+    int64_t i;
+    for (i = 0; i < N; ++i) y[i] = x[i] % p;
+}
+
+// check a 32 bit butterfly plan of 'N' points against a naive transform (with inputs that
+//   aren't reduced), and its inverse and bit reversed transforms against that
+static void check_bfly32(int64_t N, bool lazy, ntt_isa_t isa, int radix, int nthreads) {
+    ntt_plan_bfly32_t plan = NTT_PLAN_BFLY32_EMPTY;
+    ntt_plan_bfly32_init(&plan, N, 0);
+    plan.lazy = lazy;
+    if (isa < plan.isa) plan.isa = isa;
+    plan.radix = radix;
+    plan.nthreads = nthreads;
+    int64_t p = plan.p;
+
+    uint32_t* x = malloc(sizeof(*x) * N), *y = malloc(sizeof(*y) * N), *z = malloc(sizeof(*z) * N);
+    int64_t* x64 = malloc(sizeof(*x64) * N), *y64 = malloc(sizeof(*y64) * N);
+    int64_t i;
+
+    for (i = 0; i < N; ++i) z[i] = i == 1;
+    ntt_plan_bfly32_NTT(&plan, z, z);
+    int64_t w = N > 1 ? z[1] : 1;
+
+    for (i = 0; i < N; ++i) x[i] = (uint32_t)rand_mod(1LL << 32);
+    ntt_plan_bfly32_NTT(&plan, x, y);
+    widen(x, x64, N, p);
+    widen(y, y64, N, 1LL << 32);
+    CHECK(naive_ntt_ok(x64, y64, N, w, p), "bfly32 NTT N=%lld p=%lld lazy=%d isa=%d radix=%d nthreads=%d", (long long)N, (long long)p, lazy, isa, radix, nthreads);
+
+    // the inverse gives back the reduced inputs
+    ntt_plan_bfly32_INTT(&plan, y, z);
+    bool ok = true;
+    for (i = 0; i < N; ++i) {
+        if (z[i] != x64[i]) ok = false;
+    }
+    CHECK(ok, "bfly32 INTT N=%lld p=%lld lazy=%d isa=%d radix=%d nthreads=%d", (long long)N, (long long)p, lazy, isa, radix, nthreads);
+
+    int lg = 0;
+    while ((1LL << lg) < N) lg++;
+
+    ntt_plan_bfly32_NTT_bitrev(&plan, x, z);
+    ok = true;
+    for (i = 0; i < N; ++i) {
+        int64_t r = 0, t;
+        for (t = 0; t < lg; ++t) {
+            if ((i >> t) & 1) r |= 1LL << (lg - 1 - t);
+        }
+        if (z[i] != y[r]) ok = false;
+    }
+    CHECK(ok, "bfly32 NTT_bitrev N=%lld p=%lld lazy=%d isa=%d radix=%d nthreads=%d", (long long)N, (long long)p, lazy, isa, radix, nthreads);
+
+    ntt_plan_bfly32_INTT_bitrev(&plan, z, z);
+    ok = true;
+    for (i = 0; i < N; ++i) {
+        if (z[i] != x64[i]) ok = false;
+    }
+    CHECK(ok, "bfly32 INTT_bitrev N=%lld p=%lld lazy=%d isa=%d radix=%d nthreads=%d", (long long)N, (long long)p, lazy, isa, radix, nthreads);
+
+    free(x);
+    free(y);
+    free(z);
+    free(x64);
+    free(y64);
+    ntt_plan_bfly32_free(&plan);
+}
+
+// check the GEMM plans of 'N' points (64 and 32 bit) against a naive transform and each other
+static void check_gemm(int64_t N) {
+    ntt_plan_gemm_t plan = NTT_PLAN_GEMM_EMPTY;
+    ntt_plan_gemm32_t plan32 = NTT_PLAN_GEMM32_EMPTY;
+    ntt_plan_gemm_init(&plan, N, 0);
+    ntt_plan_gemm32_init(&plan32, N, (uint32_t)plan.p);
+    int64_t p = plan.p;
+
+    int64_t* x = malloc(sizeof(*x) * N), *y = malloc(sizeof(*y) * N), *z = malloc(sizeof(*z) * N);
+    uint32_t* x32 = malloc(sizeof(*x32) * N), *y32 = malloc(sizeof(*y32) * N);
+    int64_t i;
+
+    for (i = 0; i < N; ++i) z[i] = i == 1;
+    ntt_plan_gemm_NTT(&plan, z, y);
+    int64_t w = root_of(y, N);
+
+    rand_fill(x, N, p);
+    ntt_plan_gemm_NTT(&plan, x, y);
+    CHECK(naive_ntt_ok(x, y, N, w, p), "gemm NTT N=%lld p=%lld", (long long)N, (long long)p);
+    ntt_plan_gemm_INTT(&plan, y, z);
+    CHECK(same(x, z, N), "gemm INTT N=%lld p=%lld", (long long)N, (long long)p);
+
+    for (i = 0; i < N; ++i) x32[i] = (uint32_t)x[i];
+    ntt_plan_gemm32_NTT(&plan32, x32, y32);
+    widen(y32, z, N, 1LL << 32);
+    CHECK(same(y, z, N), "gemm32 NTT N=%lld p=%lld", (long long)N, (long long)p);
+    ntt_plan_gemm32_INTT(&plan32, y32, x32);
+    widen(x32, z, N, 1LL << 32);
+    CHECK(same(x, z, N), "gemm32 INTT N=%lld p=%lld", (long long)N, (long long)p);
+
+    free(x);
+    free(y);
+    free(z);
+    free(x32);
+    free(y32);
+    ntt_plan_gemm_free(&plan);
+    ntt_plan_gemm32_free(&plan32);
+}
+
+static void check_plans32() {
+    int64_t Ns[] = { 1, 2, 4, 8, 16, 64, 512, 4096 };
+    ntt_isa_t isas[] = { NTT_ISA_SCALAR, ntt_isa_detect() };
+    int i, j, lazy, radix;
+
+    for (i = 0; i < (int)(sizeof(Ns) / sizeof(*Ns)); ++i) {
+        for (j = 0; j < 2; ++j) {
+            for (lazy = 0; lazy < 2; ++lazy) {
+                for (radix = 2; radix <= 4; radix += 2) {
+                    check_bfly32(Ns[i], lazy, isas[j], radix, 1);
+                }
+            }
+        }
+    }
+
+    check_bfly32(NTT_BFLY_MT_MIN_N, true, ntt_isa_detect(), 4, 3);
+    check_bfly32(2 * NTT_BFLY_MT_MIN_N, false, NTT_ISA_SCALAR, 2, 8);
+    check_bfly32(NTT_BFLY_MT_MIN_N, true, ntt_isa_detect(), 4, 200);
+
+    check_gemm(1);
+    check_gemm(4);
+    check_gemm(16);
+    check_gemm(256);
+}
+
+
+/* Goldilocks plans */
+
+// a * b (mod NTT_GL_P)
+static uint64_t gl_mul(uint64_t a, uint64_t b) {
+    return (uint64_t)((unsigned __int128)a * b % NTT_GL_P);
+}
+
+// check a Goldilocks plan of 'N' points against a naive transform (at a sample of outputs,
+//   like 'naive_ntt_ok'), and its inverse and bit reversed transforms against that
+static void check_gl(int64_t N, int nthreads) {
+    ntt_plan_gl_t plan = NTT_PLAN_GL_EMPTY;
+    ntt_plan_gl_init(&plan, N);
+    plan.nthreads = nthreads;
+
+    uint64_t* x = malloc(sizeof(*x) * N), *y = malloc(sizeof(*y) * N), *z = malloc(sizeof(*z) * N);
+    int64_t i, k;
+
+    for (i = 0; i < N; ++i) z[i] = i == 1;
+    ntt_plan_gl_NTT(&plan, z, z);
+    uint64_t w = N > 1 ? z[1] : 1;
+
+    for (i = 0; i < N; ++i) x[i] = (uint64_t)rand_mod(1LL << 62) * 4 % NTT_GL_P;
+    ntt_plan_gl_NTT(&plan, x, y);
+
+    bool ok = true;
+    int64_t step = N <= 64 ? 1 : N / 61 + 1;
+    for (k = 0; k < N; k += step) {
+        uint64_t s = 0, wk = 1, wi = 1;
+        for (i = 0; i < k; ++i) wk = gl_mul(wk, w);
+        for (i = 0; i < N; ++i) {
+            s = (uint64_t)(((unsigned __int128)s + gl_mul(x[i], wi)) % NTT_GL_P);
+            wi = gl_mul(wi, wk);
+        }
+        if (s != y[k]) ok = false;
+    }
+    // 'w' has to have order N
+    uint64_t o = 1;
+    for (i = 0; i < N; ++i) {
+        if (i > 0 && o == 1) ok = false;
+        o = gl_mul(o, w);
+    }
+    CHECK(ok && o == 1, "gl NTT N=%lld nthreads=%d", (long long)N, nthreads);
+
+    ntt_plan_gl_INTT(&plan, y, z);
+    CHECK(memcmp(x, z, sizeof(*x) * N) == 0, "gl INTT N=%lld nthreads=%d", (long long)N, nthreads);
+
+    int lg = 0;
+    while ((1LL << lg) < N) lg++;
+
+    ntt_plan_gl_NTT_bitrev(&plan, x, z);
+    ok = true;
+    for (i = 0; i < N; ++i) {
+        int64_t r = 0, t;
+        for (t = 0; t < lg; ++t) {
+            if ((i >> t) & 1) r |= 1LL << (lg - 1 - t);
+        }
+        if (z[i] != y[r]) ok = false;
+    }
+    CHECK(ok, "gl NTT_bitrev N=%lld nthreads=%d", (long long)N, nthreads);
+
+    ntt_plan_gl_INTT_bitrev(&plan, z, z);
+    CHECK(memcmp(x, z, sizeof(*x) * N) == 0, "gl INTT_bitrev N=%lld nthreads=%d", (long long)N, nthreads);
+
+    free(x);
+    free(y);
+    free(z);
+    ntt_plan_gl_free(&plan);
+}
+
+static void check_gls() {
+    int64_t Ns[] = { 1, 2, 4, 8, 64, 1024, 4096 };
+    int nts[] = { 1, 3, 8, 64, 200, 256 };
+    int i;
+
+    for (i = 0; i < (int)(sizeof(Ns) / sizeof(*Ns)); ++i) {
+        check_gl(Ns[i], 1);
+    }
+
+    // with more threads than some (or all) of the stages have butterflies
+    for (i = 0; i < (int)(sizeof(nts) / sizeof(*nts)); ++i) {
+        check_gl(8, nts[i]);
+        check_gl(NTT_BFLY_MT_MIN_N, nts[i]);
+    }
+}
+
+
+/* Bluestein plans */
+
+// check a Bluestein plan of 'N' points against a naive transform, and its inverse
+static void check_bluestein(int64_t N) {
+    ntt_plan_bluestein_t plan = NTT_PLAN_BLUESTEIN_EMPTY;
+    ntt_plan_bluestein_init(&plan, N, 0);
+    int64_t p = plan.p;
+
+    int64_t* x = malloc(sizeof(*x) * N), *y = malloc(sizeof(*y) * N), *z = malloc(sizeof(*z) * N);
+    int64_t i;
+
+    for (i = 0; i < N; ++i) z[i] = i == 1;
+    ntt_plan_bluestein_NTT(&plan, z, z);
+    int64_t w = root_of(z, N);
+
+    rand_fill(x, N, p);
+    ntt_plan_bluestein_NTT(&plan, x, y);
+    CHECK(naive_ntt_ok(x, y, N, w, p), "bluestein NTT N=%lld p=%lld", (long long)N, (long long)p);
+
+    ntt_plan_bluestein_INTT(&plan, y, z);
+    CHECK(same(x, z, N), "bluestein INTT N=%lld p=%lld", (long long)N, (long long)p);
+
+    free(x);
+    free(y);
+    free(z);
+    ntt_plan_bluestein_free(&plan);
+}
+
+static void check_bluesteins() {
+    int64_t Ns[] = { 1, 2, 7, 11, 13, 14, 49, 97, 100, 1009 };
+    int i;
+    for (i = 0; i < (int)(sizeof(Ns) / sizeof(*Ns)); ++i) {
+        check_bluestein(Ns[i]);
+    }
+}
+
+// check the pruned transforms of 'N' points against the full ones, with 'n' nonzero inputs
+//   (or valid outputs)
+static void check_bfly_pruned(int64_t N, int64_t n) {
+    ntt_plan_bfly_t plan = NTT_PLAN_BFLY_EMPTY;
+    ntt_plan_bfly_init(&plan, N, 0);
+
+    int64_t* x = malloc(sizeof(*x) * N), *y = malloc(sizeof(*y) * N), *z = malloc(sizeof(*z) * N);
+
+    rand_fill(x, N, plan.p);
+    memset(x + n, 0, sizeof(*x) * (N - n));
+    ntt_plan_bfly_NTT_bitrev(&plan, x, y);
+
+    // garbage past 'n', which shouldn't be read
+    memcpy(z, x, sizeof(*z) * N);
+    memset(z + n, 0x7f, sizeof(*z) * (N - n));
+    ntt_plan_bfly_NTT_bitrev_pruned(&plan, z, n, z);
+    CHECK(same(y, z, N), "bfly NTT_bitrev_pruned N=%lld n_in=%lld", (long long)N, (long long)n);
+
+    rand_fill(y, N, plan.p);
+    ntt_plan_bfly_INTT_bitrev(&plan, y, x);
+    ntt_plan_bfly_INTT_bitrev_pruned(&plan, y, z, n);
+    CHECK(same(x, z, n), "bfly INTT_bitrev_pruned N=%lld n_out=%lld", (long long)N, (long long)n);
+
+    free(x);
+    free(y);
+    free(z);
+    ntt_plan_bfly_free(&plan);
+}
+
+static void check_bflys_pruned() {
+    check_bfly_pruned(1, 1);
+    check_bfly_pruned(8, 1);
+    check_bfly_pruned(8, 3);
+    check_bfly_pruned(64, 32);
+    check_bfly_pruned(64, 17);
+    check_bfly_pruned(1024, 1000);
+    check_bfly_pruned(4096, 2048);
+    check_bfly_pruned(4096, 1);
+    check_bfly_pruned(4096, 4096);
+}
+
+
+/* multipliers */
+
+// check a multiplier's products of 'nA' and 'nB' random coefficients below 2^'bits' (which
+//   must fit in its 'N'), truncated to 'nC', against the schoolbook product
+static void check_multer_pruned(ntt_multer_t* multer, const char* name, int bits, int64_t nA, int64_t nB, int64_t nC) {
+    int64_t* A = malloc(sizeof(*A) * (nA + 1)), *B = malloc(sizeof(*B) * (nB + 1));
+    int64_t* C = malloc(sizeof(*C) * (nC + 1)), *D = malloc(sizeof(*D) * (nC + 1));
+
+    rand_fill(A, nA, 1LL << bits);
+    rand_fill(B, nB, 1LL << bits);
+    schoolbook(A, nA, B, nB, D, nC, 0);
+
+    // and that nothing past 'nC' is written
+    C[nC] = -1;
+    ntt_multer_mult_pruned(multer, A, nA, B, nB, C, nC);
+    CHECK(same(C, D, nC) && C[nC] == -1, "%s mult_pruned N=%lld nA=%lld nB=%lld nC=%lld", name, (long long)multer->N, (long long)nA, (long long)nB, (long long)nC);
+
+    free(A);
+    free(B);
+    free(C);
+    free(D);
+}
+
+// check a multiplier's squares of 'nA' random coefficients below 2^'bits', truncated to
+//   'nC', against the schoolbook product (with both 'ntt_multer_sqr', and the same operand
+//   passed twice to 'ntt_multer_mult_pruned')
+static void check_multer_sqr(ntt_multer_t* multer, const char* name, int bits, int64_t nA, int64_t nC) {
+    int64_t* A = malloc(sizeof(*A) * nA);
+    int64_t* C = malloc(sizeof(*C) * (nC + 1)), *D = malloc(sizeof(*D) * (nC + 1));
+
+    rand_fill(A, nA, 1LL << bits);
+    schoolbook(A, nA, A, nA, D, nC, 0);
+
+    C[nC] = -1;
+    ntt_multer_sqr(multer, A, nA, C, nC);
+    CHECK(same(C, D, nC) && C[nC] == -1, "%s sqr N=%lld nA=%lld nC=%lld", name, (long long)multer->N, (long long)nA, (long long)nC);
+
+    memset(C, 0, sizeof(*C) * nC);
+    ntt_multer_mult_pruned(multer, A, nA, A, nA, C, nC);
+    CHECK(same(C, D, nC), "%s mult_pruned (A == B) N=%lld nA=%lld nC=%lld", name, (long long)multer->N, (long long)nA, (long long)nC);
+
+    free(A);
+    free(C);
+    free(D);
+}
+
+// check a multiplier's product of 'nA' and 'nB' random coefficients in (-2^bits, 2^bits)
+//   against the schoolbook product, where the negative coefficients come out mod 'm' (the
+//   product of the primes, or NTT_GL_P)
+static void check_multer_signed(ntt_multer_t* multer, const char* name, uint64_t m, int bits, int64_t nA, int64_t nB) {
+    int64_t nC = nA + nB - 1, i;
+    int64_t* A = malloc(sizeof(*A) * nA), *B = malloc(sizeof(*B) * nB);
+    int64_t* C = malloc(sizeof(*C) * nC), *D = malloc(sizeof(*D) * nC);
+
+    for (i = 0; i < nA; ++i) A[i] = rand_mod(1LL << (bits + 1)) - (1LL << bits);
+    for (i = 0; i < nB; ++i) B[i] = rand_mod(1LL << (bits + 1)) - (1LL << bits);
+    schoolbook(A, nA, B, nB, D, nC, 0);
+
+    ntt_multer_mult_pruned(multer, A, nA, B, nB, C, nC);
+    bool ok = true;
+    for (i = 0; i < nC; ++i) {
+        uint64_t d = D[i] < 0 ? m - (uint64_t)(-D[i]) % m : (uint64_t)D[i] % m;
+        if ((uint64_t)C[i] % m != d % m) ok = false;
+    }
+    CHECK(ok, "%s mult_pruned (signed) N=%lld nA=%lld nB=%lld", name, (long long)multer->N, (long long)nA, (long long)nB);
+
+    free(A);
+    free(B);
+    free(C);
+    free(D);
+}
+
+// check a multiplier's full (cyclic) product against the schoolbook one
+static void check_multer_cyclic(ntt_multer_t* multer, const char* name, int bits) {
+    int64_t N = multer->N;
+    int64_t* A = malloc(sizeof(*A) * N), *B = malloc(sizeof(*B) * N);
+    int64_t* C = malloc(sizeof(*C) * N), *D = malloc(sizeof(*D) * N);
+
+    rand_fill(A, N, 1LL << bits);
+    rand_fill(B, N, 1LL << bits);
+    schoolbook(A, N, B, N, D, N, N);
+
+    ntt_multer_mult(multer, A, B, C);
+    CHECK(same(C, D, N), "%s mult N=%lld", name, (long long)N);
+
+    free(A);
+    free(B);
+    free(C);
+    free(D);
+}
+
+// check a multiplier's products by a prepared operand of 'nB' coefficients, for a few
+//   different 'A' of 'nA' coefficients (truncated to 'nC'), against the schoolbook products,
+//   and the same for integers in limbs (with 'limbs')
+static void check_multer_prepared(ntt_multer_t* multer, const char* name, bool limbs, int64_t nA, int64_t nB, int64_t nC) {
+    int bits = limbs ? multer->limb_bits : 8;
+    int64_t* A = malloc(sizeof(*A) * nA), *B = malloc(sizeof(*B) * nB);
+    int64_t* C = malloc(sizeof(*C) * (nC + 1)), *D = malloc(sizeof(*D) * (nC + 1));
+    ntt_multer_prep_t prep = NTT_MULTER_PREP_EMPTY;
+    int r, t;
+
+    // prepare twice, to check that the old transforms are replaced
+    for (r = 0; r < 2; ++r) {
+        rand_fill(B, nB, 1LL << bits);
+        ntt_multer_prepare(multer, B, nB, &prep);
+
+        for (t = 0; t < 3; ++t) {
+            rand_fill(A, nA, 1LL << bits);
+
+            C[nC] = -1;
+            if (limbs) {
+                schoolbook_limbs(A, nA, B, nB, D, nC, bits);
+                ntt_multer_mult_prepared_limbs(multer, A, nA, &prep, C, nC);
+            } else {
+                schoolbook(A, nA, B, nB, D, nC, 0);
+                ntt_multer_mult_prepared(multer, A, nA, &prep, C, nC);
+            }
+            CHECK(same(C, D, nC) && C[nC] == -1, "%s mult_prepared%s N=%lld nA=%lld nB=%lld nC=%lld", name, limbs ? "_limbs" : "", (long long)multer->N, (long long)nA, (long long)nB, (long long)nC);
+        }
+    }
+
+    ntt_multer_prep_free(&prep);
+    free(A);
+    free(B);
+    free(C);
+    free(D);
+}
+
+// check a multiplier's product of the integers 'A' and 'B' in 'nA' and 'nB' random limbs
+//   (truncated to 'nC' limbs) against the schoolbook product
+static void check_multer_limbs(ntt_multer_t* multer, const char* name, int64_t nA, int64_t nB, int64_t nC) {
+    int bits = multer->limb_bits;
+    int64_t* A = malloc(sizeof(*A) * nA), *B = malloc(sizeof(*B) * nB);
+    int64_t* C = malloc(sizeof(*C) * (nC + 1)), *D = malloc(sizeof(*D) * (nC + 1));
+    int64_t i;
+
+    // all ones (the largest carries) or random
+    int t;
+    for (t = 0; t < 2; ++t) {
+        if (t == 0) {
+            for (i = 0; i < nA; ++i) A[i] = (1LL << bits) - 1;
+            for (i = 0; i < nB; ++i) B[i] = (1LL << bits) - 1;
+        } else {
+            rand_fill(A, nA, 1LL << bits);
+            rand_fill(B, nB, 1LL << bits);
+        }
+        schoolbook_limbs(A, nA, B, nB, D, nC, bits);
+
+        C[nC] = -1;
+        ntt_multer_mult_limbs(multer, A, nA, B, nB, C, nC);
+        CHECK(same(C, D, nC) && C[nC] == -1, "%s mult_limbs N=%lld nA=%lld nB=%lld nC=%lld", name, (long long)multer->N, (long long)nA, (long long)nB, (long long)nC);
+    }
+
+    free(A);
+    free(B);
+    free(C);
+    free(D);
+}
+
+// check a multiplier's middle product of 'nA' and 'nB' random coefficients, and its high
+//   product (the top 'nC' coefficients), against the schoolbook product
+static void check_multer_mulmid(ntt_multer_t* multer, const char* name, int64_t nA, int64_t nB, int64_t nC) {
+    int64_t n = nA + nB - 1;
+    int64_t* A = malloc(sizeof(*A) * nA), *B = malloc(sizeof(*B) * nB);
+    int64_t* C = malloc(sizeof(*C) * (n + 1)), *D = malloc(sizeof(*D) * n);
+
+    rand_fill(A, nA, 256);
+    rand_fill(B, nB, 256);
+    schoolbook(A, nA, B, nB, D, n, 0);
+
+    if (nA >= nB && nA <= multer->N) {
+        C[nA - nB + 1] = -1;
+        ntt_multer_mulmid(multer, A, nA, B, nB, C);
+        CHECK(same(C, D + nB - 1, nA - nB + 1) && C[nA - nB + 1] == -1, "%s mulmid N=%lld nA=%lld nB=%lld", name, (long long)multer->N, (long long)nA, (long long)nB);
+    }
+
+    C[nC] = -1;
+    ntt_multer_mulhigh(multer, A, nA, B, nB, C, nC);
+    CHECK(same(C, D + n - nC, nC) && C[nC] == -1, "%s mulhigh N=%lld nA=%lld nB=%lld nC=%lld", name, (long long)multer->N, (long long)nA, (long long)nB, (long long)nC);
+
+    free(A);
+    free(B);
+    free(C);
+    free(D);
+}
+
+static void check_multers() {
+    ntt_multer_t multer = NTT_MULTER_EMPTY;
+    int64_t Ns[] = { 1, 2, 5, 64, 1000, 4096 };
+    int i;
+
+    for (i = 0; i < (int)(sizeof(Ns) / sizeof(*Ns)); ++i) {
+        ntt_multer_init(&multer, Ns[i]);
+        int64_t N = multer.N;
+
+        // squares first, before the buffers for 'B' are allocated
+        check_multer_sqr(&multer, "multer", 8, (N + 1) / 2, 2 * ((N + 1) / 2) - 1);
+        check_multer_sqr(&multer, "multer", 8, (N + 1) / 2, N / 3 + 1);
+
+        check_multer_cyclic(&multer, "multer", 8);
+        check_multer_pruned(&multer, "multer", 8, (N + 1) / 2, N / 2 + 1, N);
+        check_multer_pruned(&multer, "multer", 8, 1, N, N);
+        if (N > 4) {
+            check_multer_pruned(&multer, "multer", 8, N / 2, N / 2, N / 2);
+            check_multer_pruned(&multer, "multer", 8, N / 3, N / 4, 3);
+            check_multer_pruned(&multer, "multer", 8, N / 2, 1, N / 2);
+        }
+        check_multer_sqr(&multer, "multer", 8, (N + 1) / 2, N);
+    }
+
+    // the 30 bit primes for AVX2, which use the 32 bit plans
+    for (i = 0; i < (int)(sizeof(Ns) / sizeof(*Ns)); ++i) {
+        ntt_multer_init_bits(&multer, 8 * Ns[i], 8 * Ns[i], NTT_ISA_AVX2);
+        int64_t N = multer.N;
+        CHECK(multer.plans32 != NULL || (N & (N - 1)) != 0, "multer_init_bits AVX2 N=%lld doesn't use the 32 bit plans", (long long)N);
+        check_multer_sqr(&multer, "multer32", 8, (N + 1) / 2, 2 * ((N + 1) / 2) - 1);
+        check_multer_sqr(&multer, "multer32", 8, (N + 1) / 2, N / 3 + 1);
+
+        check_multer_pruned(&multer, "multer32", 8, (N + 1) / 2, N / 2 + 1, N);
+        check_multer_pruned(&multer, "multer32", 8, N / 2 + 1, N / 3 + 1, N / 2 + 1);
+        check_multer_sqr(&multer, "multer32", 8, (N + 1) / 2, N);
+    }
+
+    // a single transform mod the Goldilocks prime
+    for (i = 0; i < (int)(sizeof(Ns) / sizeof(*Ns)); ++i) {
+        ntt_multer_init_gl(&multer, Ns[i]);
+        int64_t N = multer.N;
+
+        // squares first, before the buffers for 'B' are allocated
+        check_multer_sqr(&multer, "multer_gl", 8, (N + 1) / 2, 2 * ((N + 1) / 2) - 1);
+        check_multer_sqr(&multer, "multer_gl", 8, (N + 1) / 2, N / 3 + 1);
+
+        check_multer_cyclic(&multer, "multer_gl", 8);
+        check_multer_pruned(&multer, "multer_gl", 8, (N + 1) / 2, N / 2 + 1, N);
+        check_multer_pruned(&multer, "multer_gl", 8, N / 2 + 1, N / 3 + 1, N / 2 + 1);
+        check_multer_sqr(&multer, "multer_gl", 8, (N + 1) / 2, N);
+    }
+
+    // prepared operands, for each kind of multiplier
+    for (i = 0; i < (int)(sizeof(Ns) / sizeof(*Ns)); ++i) {
+        int k;
+        for (k = 0; k < 3; ++k) {
+            const char* name = k == 0 ? "multer" : k == 1 ? "multer32" : "multer_gl";
+            if (k == 0) ntt_multer_init(&multer, Ns[i]);
+            else if (k == 1) ntt_multer_init_bits(&multer, 8 * Ns[i], 8 * Ns[i], NTT_ISA_AVX2);
+            else ntt_multer_init_gl(&multer, Ns[i]);
+            int64_t N = multer.N;
+
+            check_multer_prepared(&multer, name, false, (N + 1) / 2, N / 2 + 1, N);
+            check_multer_prepared(&multer, name, false, N / 2 + 1, (N + 1) / 2, N / 3 + 1);
+            check_multer_prepared(&multer, name, true, (N + 1) / 2, N / 2 + 1, N + 1);
+            check_multer_prepared(&multer, name, true, N / 2 + 1, (N + 1) / 2, N / 2);
+        }
+    }
+
+    // with limbs of more than 8 bits (and more primes), for each target
+    ntt_isa_t targets[] = { NTT_ISA_SCALAR, NTT_ISA_AVX2, ntt_isa_detect() };
+    for (i = 0; i < (int)(sizeof(targets) / sizeof(*targets)); ++i) {
+        ntt_multer_init_bits(&multer, 32 * 1000, 32 * 700, targets[i]);
+        int64_t nA = multer.nA, nB = multer.nB;
+        if (nA + nB - 1 > multer.N) nA = multer.N - nB + 1;
+
+        check_multer_prepared(&multer, "multer_bits", true, nA, nB, nA + nB);
+        check_multer_prepared(&multer, "multer_bits", true, nA, nB, nA);
+    }
+
+    // negative coefficients, like (-3 + 2x) * (5 + x), which are reduced like the plans' inputs
+    int64_t nA2[] = { -3, 2 }, nB2[] = { 5, 1 }, nC3[3];
+    ntt_multer_init(&multer, 16);
+    ntt_multer_mult_pruned(&multer, nA2, 2, nB2, 2, nC3, 3);
+    CHECK(nC3[0] == multer.prod_p - 15 && nC3[1] == 7 && nC3[2] == 2, "multer mult_pruned (-3 + 2x) * (5 + x)");
+    check_multer_signed(&multer, "multer", multer.prod_p, 7, 8, 8);
+    for (i = 0; i < (int)(sizeof(targets) / sizeof(*targets)); ++i) {
+        ntt_multer_init_bits(&multer, 8 * 1000, 8 * 1000, targets[i]);
+        if (multer.prod_p > 0) check_multer_signed(&multer, "multer_bits", multer.prod_p, 7, multer.N / 2, multer.N / 3);
+    }
+
+    ntt_multer_init_gl(&multer, 16);
+    ntt_multer_mult_pruned(&multer, nA2, 2, nB2, 2, nC3, 3);
+    CHECK((uint64_t)nC3[0] == NTT_GL_P - 15 && nC3[1] == 7 && nC3[2] == 2, "multer_gl mult_pruned (-3 + 2x) * (5 + x)");
+    ntt_multer_init_gl(&multer, 1000);
+    check_multer_signed(&multer, "multer_gl", NTT_GL_P, 20, multer.N / 2, multer.N / 2);
+
+    // products in limbs, which may be truncated so that they'd wrap around (nC <= N < nA + nB - 1),
+    //   or be done in chunks
+    ntt_multer_init(&multer, 16);
+    int64_t N = multer.N;
+    check_multer_limbs(&multer, "multer", 12, 12, 10);
+    check_multer_limbs(&multer, "multer", 12, 12, 24);
+    check_multer_limbs(&multer, "multer", N, N, N);
+    check_multer_limbs(&multer, "multer", N / 2, N / 2, N);
+    check_multer_limbs(&multer, "multer", 1, 1, 2);
+    check_multer_limbs(&multer, "multer", 3, 100, 103);
+    check_multer_limbs(&multer, "multer", 100, 3, 50);
+    check_multer_limbs(&multer, "multer", 2 * N, 3 * N, 5 * N);
+    check_multer_limbs(&multer, "multer", 2 * N + 1, 2 * N - 1, 3 * N);
+    check_multer_limbs(&multer, "multer", 5 * N, 5 * N, N - 1);
+
+    for (i = 0; i < (int)(sizeof(targets) / sizeof(*targets)); ++i) {
+        ntt_multer_init_bits(&multer, 32 * 1000, 32 * 700, targets[i]);
+        int64_t nA = multer.nA, nB = multer.nB;
+        N = multer.N;
+
+        check_multer_limbs(&multer, "multer_bits", nA, nB, nA + nB);
+        check_multer_limbs(&multer, "multer_bits", nA, nB, nA);
+        check_multer_limbs(&multer, "multer_bits", 20 * N, nB / 2, 20 * N + nB / 2);
+        check_multer_limbs(&multer, "multer_bits", 2 * N, 2 * N, 4 * N);
+    }
+
+    ntt_multer_init_gl(&multer, 256);
+    N = multer.N;
+    check_multer_limbs(&multer, "multer_gl", N, N, N + 10);
+    check_multer_limbs(&multer, "multer_gl", 3 * N, N / 4, 3 * N + N / 4);
+    check_multer_limbs(&multer, "multer_gl", 2 * N, 2 * N, 4 * N);
+
+    // middle and high products, which need a smaller N than the full product
+    for (i = 0; i < 3; ++i) {
+        const char* name = i == 0 ? "multer" : i == 1 ? "multer32" : "multer_gl";
+        if (i == 0) ntt_multer_init(&multer, 1000);
+        else if (i == 1) ntt_multer_init_bits(&multer, 8 * 1000, 8 * 1000, NTT_ISA_AVX2);
+        else ntt_multer_init_gl(&multer, 1000);
+        N = multer.N;
+
+        check_multer_mulmid(&multer, name, N, N / 2, N / 2);
+        check_multer_mulmid(&multer, name, N, N, 1);
+        check_multer_mulmid(&multer, name, N, 1, N);
+        check_multer_mulmid(&multer, name, N - 3, N / 3, N / 3 + 5);
+        check_multer_mulmid(&multer, name, 1, 1, 1);
+        check_multer_mulmid(&multer, name, 7, 5, 11);
+        check_multer_mulmid(&multer, name, 3 * N, N / 2, N / 2);
+        check_multer_mulmid(&multer, name, 5 * N, 5 * N, N / 2);
+    }
+
+    ntt_multer_free(&multer);
+}
+
+
+/* four-step plans */
+
+// check a four-step plan of 'N' points against a naive transform, and its inverse
+static void check_fourstep(int64_t N) {
+    ntt_plan_fourstep_t plan = NTT_PLAN_FOURSTEP_EMPTY;
+    ntt_plan_fourstep_init(&plan, N, 0);
+    int64_t p = plan.p;
+
+    int64_t* x = malloc(sizeof(*x) * N), *y = malloc(sizeof(*y) * N), *z = malloc(sizeof(*z) * N);
+    int64_t i;
+
+    for (i = 0; i < N; ++i) z[i] = i == 1;
+    ntt_plan_fourstep_NTT(&plan, z, z);
+    int64_t w = root_of(z, N);
+
+    rand_fill(x, N, p);
+    ntt_plan_fourstep_NTT(&plan, x, y);
+    CHECK(plan.N1 * plan.N2 == N && naive_ntt_ok(x, y, N, w, p), "fourstep NTT N=%lld (N1=%lld, N2=%lld)", (long long)N, (long long)plan.N1, (long long)plan.N2);
+
+    ntt_plan_fourstep_INTT(&plan, y, z);
+    CHECK(same(x, z, N), "fourstep INTT N=%lld", (long long)N);
+
+    free(x);
+    free(y);
+    free(z);
+    ntt_plan_fourstep_free(&plan);
+}
+
+static void check_foursteps() {
+    int64_t Ns[] = { 1, 2, 4, 8, 9, 12, 15, 45, 64, 96, 100, 1024, 3 * 4096, 1 << 16 };
+    int i;
+    for (i = 0; i < (int)(sizeof(Ns) / sizeof(*Ns)); ++i) {
+        check_fourstep(Ns[i]);
+    }
+}
+
+
+int main(void) {
+    srand(1234);
+
+    check_bflys();
+    check_bflys_mixed();
+    check_bluesteins();
+    check_bflys_pruned();
+    check_plans32();
+    check_gls();
+    check_foursteps();
+
+    check_multers();
+
+    if (n_fail == 0) printf("all checks passed\n");
+    return n_fail;
+}